@@ -0,0 +1,78 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <vector>
+
+// per-thread scratch buffers of the simulation hot path. Every (element type, tag) has one pooled
+// vector per thread that a user borrows (swapped out of the pool) and hands back when done, so its
+// capacity grows to the largest size the thread needs and is then reused without touching the heap.
+// a nested borrow of the same kind just finds the pool empty and allocates its own buffer
+enum ScratchTag {
+  SCRATCH_STATE,       // recall engine states
+  SCRATCH_FIELDS,      // recall engine local fields
+  SCRATCH_PREV,        // synchronous batch recall previous states
+  SCRATCH_FLIPS,       // batch recall flips per probe
+  SCRATCH_SLOT,        // batch recall output slot per probe
+  SCRATCH_ORDER,       // recall engine update order (one per probe of the batch engine)
+  SCRATCH_STREAMS,     // batch recall random stream per probe
+  SCRATCH_BASE_STATE,  // batch recall states of the base of hammed probes
+  SCRATCH_BASE_FIELDS, // batch recall fields of the base of hammed probes
+  SCRATCH_FLIP_LIST,   // flipped neurons of the hammed probes of count_converged
+  SCRATCH_RETRIEVED,   // recalled probes of count_converged
+  SCRATCH_TRAIN,       // training patterns of train_network
+  SCRATCH_HAMMED,      // shuffled neuron indices of the probe generators
+  SCRATCH_BITS,        // transposed pattern bits of the hebbian kernels
+  SCRATCH_WORDS        // random words of Vector::randomize
+};
+
+template<typename T, int Tag>
+std::vector<T> &scratch_pool() {
+  static thread_local std::vector<T> pool;
+  return pool;
+}
+
+// lend the pooled buffer to v (resized to n, old contents unspecified) / give it back
+template<int Tag, typename T>
+void scratch_take(std::vector<T> &v, const size_t n) {
+  v.swap(scratch_pool<T, Tag>());
+  v.resize(n);
+}
+
+template<int Tag, typename T>
+void scratch_return(std::vector<T> &v) {
+  scratch_pool<T, Tag>().swap(v);
+}
+
+// borrows the pooled buffer for its lifetime, as left by the last borrower
+// (pattern sets keep their patterns so they can be overwritten in place)
+template<typename T, int Tag>
+class Scratch {
+public:
+  Scratch() { buf_.swap(scratch_pool<T, Tag>()); }
+  ~Scratch() { scratch_return<Tag>(buf_); }
+  Scratch(const Scratch &) = delete;
+  Scratch &operator=(const Scratch &) = delete;
+
+  std::vector<T> &operator*() { return buf_; }
+
+private:
+  std::vector<T> buf_;
+};
+
+// make patts hold num patterns of N neurons, keeping (and so not reallocating) the ones it has
+template<typename P>
+void size_patterns(std::vector<P> &patts, const size_t num, const size_t N) {
+  if (patts.size() < num) {
+    patts.resize(num, P(N));
+  } else {
+    patts.erase(patts.begin() + num, patts.end());
+  }
+  for (P &patt : patts) {
+    if (patt.num_rows() != N) {
+      patt = P(N);
+    }
+  }
+}
+
+#endif
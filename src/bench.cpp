@@ -0,0 +1,394 @@
+#include "matrix.hpp"
+#include "symmetric.hpp"
+#include "quantized.hpp"
+#include "fixed.hpp"
+#include "bipolar.hpp"
+#include "store.hpp"
+#include "vector.hpp"
+#include "packed.hpp"
+#include "random.hpp"
+#include "proportion.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include <cstdio>
+#include <string.h>
+#include <stdlib.h>
+#include <omp.h>
+
+// micro benchmarks of the hot kernels plus a reduced proportion sweep
+//   ./bench [--sizes 50,256,1024] [--patterns P] [--threads 1,4] [--min-time S] [--sims S] [--seed N] [--label L] [--out file.json]
+//           [--bipolar avx512|avx2|portable]
+// every (kernel, neurons, threads) is repeated until it ran for at least --min-time seconds,
+// results are printed as a table on stderr and written as JSON (stdout or --out)
+// flops and bytes are nominal per op models (dense equivalent work and weight traffic) used for GFLOP/s and B/s
+
+#define BENCH_DEFAULT_SIZES "50,128,256,512,1024,2048,4096,8192"
+#define BENCH_MIN_TIME 0.25 // seconds every measurement runs for
+#define BENCH_RUN_PATTERNS 100 // probes per proportion simulation (as in the sweep)
+#define BENCH_HAMMING_FRACTION 0.1 // probes are this fraction of N away from the stored pattern
+
+volatile double bench_sink = 0.0; // keeps results alive so kernels are not optimized out
+
+struct BenchConfig {
+  std::vector<size_t> sizes;
+  std::vector<size_t> threads;
+  size_t patterns;  // 0 means the Hebbian capacity N / (2 ln N)
+  size_t sims;      // simulations per reduced sweep measurement (0 means one per thread)
+  double min_time;
+  uint64_t seed;
+  std::string label;
+  std::string out;
+};
+
+struct BenchResult {
+  std::string kernel;
+  size_t neurons, patterns, threads, reps;
+  double ns_per_op, flops_per_op, bytes_per_op;
+};
+
+std::vector<size_t> parse_list(const char *arg) {
+  std::vector<size_t> vals;
+  std::stringstream stream(arg);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      vals.push_back(static_cast<size_t>(strtoull(item.c_str(), NULL, 10)));
+    }
+  }
+  return vals;
+}
+
+// run fn (which performs ops_per_call ops) until min_time seconds have passed, returns ns per op
+template<typename Fn>
+double time_op(Fn fn, const size_t ops_per_call, const double min_time, size_t &reps) {
+  reps = 1;
+  while (true) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < reps; r++) {
+      fn();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (elapsed >= min_time) {
+      return (elapsed * 1e9) / static_cast<double>(reps * ops_per_call);
+    }
+
+    // grow towards the target time (at least doubling)
+    double scale = (elapsed > 0.0) ? (1.2 * min_time / elapsed) : 2.0;
+    reps = static_cast<size_t>(static_cast<double>(reps) * std::max(2.0, std::min(scale, 100.0)));
+  }
+}
+
+void report(std::vector<BenchResult> &results, const BenchResult &res) {
+  results.push_back(res);
+  double gflops = res.flops_per_op / res.ns_per_op;
+  double gbytes = res.bytes_per_op / res.ns_per_op;
+  fprintf(stderr, "%-22s N=%-6zu P=%-5zu threads=%-3zu %14.1f ns/op %9.3f GFLOP/s %9.3f GB/s\n",
+    res.kernel.c_str(), res.neurons, res.patterns, res.threads, res.ns_per_op, gflops, gbytes);
+}
+
+void bench_size(const BenchConfig &config, const size_t N, const size_t threads, std::vector<BenchResult> &results) {
+  const size_t P = (config.patterns > 0) ? config.patterns
+    : std::max(static_cast<size_t>(1), static_cast<size_t>(std::ceil(static_cast<double>(N) / (2.0 * std::log(static_cast<double>(N))))));
+  const double n = static_cast<double>(N);
+  const double n2 = n * n;
+  const size_t hamming = static_cast<size_t>(BENCH_HAMMING_FRACTION * n);
+  const double min_time = config.min_time;
+  omp_set_num_threads(static_cast<int>(threads));
+
+  // stored patterns, a trained network and a probe near the first pattern
+  Rng rng = Rng(config.seed).split(N);
+  packed_patterns_t patterns;
+  make_random_patterns(N, patterns, P, rng);
+  hopfield_t hopfield(N, N);
+  hopfield.train_on(patterns);
+
+  packed_patterns_t probes;
+  make_hammed_patterns(patterns[0], probes, 1, hamming, false, rng);
+  const packed_pattern_t &probe = probes[0];
+
+  Vector<double> x = patterns[0].unpack<double>();
+  Vector<double> y(N);
+  size_t reps = 0;
+  double ns = 0.0;
+
+  // y += W x
+  ns = time_op([&]() {
+    y.zeroize();
+    matmult(&hopfield, x, y);
+    bench_sink = bench_sink + y(0);
+  }, 1, min_time, reps);
+  report(results, {"matmult", N, P, threads, reps, ns, 2.0 * n2, 8.0 * n2 + 16.0 * n});
+
+  // a single row of W x (op = one row)
+  ns = time_op([&]() {
+    double sum = 0.0;
+    for (size_t row = 0; row < N; row++) {
+      sum += matmultvec(&hopfield, row, x);
+    }
+    bench_sink = bench_sink + sum;
+  }, N, min_time, reps);
+  report(results, {"matmultvec", N, P, threads, reps, ns, 2.0 * n, 16.0 * n});
+
+  // the same from the packed states (sign flips instead of multiplies, flops count the adds)
+  const packed_pattern_t &s = patterns[0];
+  ns = time_op([&]() {
+    y.zeroize();
+    matmult(&hopfield, s, y);
+    bench_sink = bench_sink + y(0);
+  }, 1, min_time, reps);
+  report(results, {"matmult_bipolar", N, P, threads, reps, ns, n2, 8.0 * n2 + n / 8.0 + 8.0 * n});
+
+  ns = time_op([&]() {
+    double sum = 0.0;
+    for (size_t row = 0; row < N; row++) {
+      sum += matmultvec(&hopfield, row, s);
+    }
+    bench_sink = bench_sink + sum;
+  }, N, min_time, reps);
+  report(results, {"matmultvec_bipolar", N, P, threads, reps, ns, n, 8.0 * n + n / 8.0});
+
+  ns = time_op([&]() {
+    bench_sink = bench_sink + hopfield.energy(probe);
+  }, 1, min_time, reps);
+  report(results, {"energy", N, P, threads, reps, ns, 3.0 * n2, 8.0 * n2});
+
+  // modelled as the dense rank-P update X^T X
+  ns = time_op([&]() {
+    hopfield.train_on(patterns);
+    bench_sink = bench_sink + hopfield(0, N - 1);
+  }, 1, min_time, reps);
+  report(results, {"train_on", N, P, threads, reps, ns, 2.0 * n2 * static_cast<double>(P), 8.0 * n2});
+
+  // one recall from N/10 flips away (modelled as the initial field pass)
+  packed_pattern_t retrieved(N);
+  ns = time_op([&]() {
+    bench_sink = bench_sink + static_cast<double>(hopfield.run_to_min(probe, retrieved, rng));
+  }, 1, min_time, reps);
+  report(results, {"run_to_min", N, P, threads, reps, ns, 2.0 * n2, 8.0 * n2});
+
+  // persist the trained network and use it in place from a read-only mapping
+  const std::string store_path = "bench-weights.bin";
+  ns = time_op([&]() {
+    save_weights(store_path, hopfield);
+  }, 1, min_time, reps);
+  report(results, {"save_weights", N, P, threads, reps, ns, 0.0, 8.0 * n2});
+
+  // mapping is lazy, so the op includes one recall that faults every weight page in
+  ns = time_op([&]() {
+    hopfield_view_t view(store_path);
+    bench_sink = bench_sink + static_cast<double>(view.run_to_min(probe, retrieved, rng));
+  }, 1, min_time, reps);
+  report(results, {"map_run_to_min", N, P, threads, reps, ns, 2.0 * n2, 8.0 * n2});
+  std::remove(store_path.c_str());
+
+  // the same kernels on the packed upper triangle (half the weight traffic)
+  sym_hopfield_t symmetric(N);
+  symmetric.train_on(patterns);
+
+  ns = time_op([&]() {
+    symmetric.fields(&x(0), &y(0));
+    bench_sink = bench_sink + y(0);
+  }, 1, min_time, reps);
+  report(results, {"sym_fields", N, P, threads, reps, ns, 2.0 * n2, 4.0 * n2 + 16.0 * n});
+
+  ns = time_op([&]() {
+    double sum = 0.0;
+    for (size_t row = 0; row < N; row++) {
+      sum += symmetric.field(row, &x(0));
+    }
+    bench_sink = bench_sink + sum;
+  }, N, min_time, reps);
+  report(results, {"sym_field", N, P, threads, reps, ns, 2.0 * n, 16.0 * n});
+
+  ns = time_op([&]() {
+    bench_sink = bench_sink + symmetric.energy(probe);
+  }, 1, min_time, reps);
+  report(results, {"sym_energy", N, P, threads, reps, ns, 1.5 * n2, 4.0 * n2});
+
+  ns = time_op([&]() {
+    symmetric.train_on(patterns);
+    bench_sink = bench_sink + symmetric(0, N - 1);
+  }, 1, min_time, reps);
+  report(results, {"sym_train_on", N, P, threads, reps, ns, n2 * static_cast<double>(P), 4.0 * n2});
+
+  ns = time_op([&]() {
+    bench_sink = bench_sink + static_cast<double>(symmetric.run_to_min(probe, retrieved, rng));
+  }, 1, min_time, reps);
+  report(results, {"sym_run_to_min", N, P, threads, reps, ns, 2.0 * n2, 4.0 * n2});
+
+  // integer Hebbian sums in the narrowest type for P (int8 below 128 patterns)
+  quant_hopfield_t quantized(N, N);
+  quantized.train_on(patterns);
+  const double width = static_cast<double>(quantized.width());
+  std::vector<int32_t> xi(N), yi(N);
+  for (size_t i = 0; i < N; i++) {
+    xi[i] = static_cast<int32_t>(patterns[0](i));
+  }
+
+  ns = time_op([&]() {
+    quantized.fields(&xi[0], &yi[0]);
+    bench_sink = bench_sink + yi[0];
+  }, 1, min_time, reps);
+  report(results, {"quant_fields", N, P, threads, reps, ns, 2.0 * n2, width * n2 + 8.0 * n});
+
+  ns = time_op([&]() {
+    quantized.train_on(patterns);
+    bench_sink = bench_sink + quantized(0, N - 1);
+  }, 1, min_time, reps);
+  report(results, {"quant_train_on", N, P, threads, reps, ns, 2.0 * n2 * static_cast<double>(P), width * n2});
+
+  ns = time_op([&]() {
+    bench_sink = bench_sink + static_cast<double>(quantized.run_to_min(probe, retrieved, rng));
+  }, 1, min_time, reps);
+  report(results, {"quant_run_to_min", N, P, threads, reps, ns, 2.0 * n2, width * n2});
+
+  // the dense kernels compiled for exactly N neurons (only sizes in FIXED_SIZES)
+  if (has_fixed_kernel(N)) {
+    with_fixed_hopfield(N, [&](auto &fixed) {
+      fixed.train_on(patterns);
+
+      ns = time_op([&]() {
+        fixed.fields(&x(0), &y(0));
+        bench_sink = bench_sink + y(0);
+      }, 1, min_time, reps);
+      report(results, {"fixed_fields", N, P, threads, reps, ns, 2.0 * n2, 8.0 * n2 + 16.0 * n});
+
+      ns = time_op([&]() {
+        bench_sink = bench_sink + fixed.energy(probe);
+      }, 1, min_time, reps);
+      report(results, {"fixed_energy", N, P, threads, reps, ns, 2.0 * n2, 8.0 * n2});
+
+      ns = time_op([&]() {
+        fixed.train_on(patterns);
+        bench_sink = bench_sink + fixed(0, N - 1);
+      }, 1, min_time, reps);
+      report(results, {"fixed_train_on", N, P, threads, reps, ns, 2.0 * n2 * static_cast<double>(P), 8.0 * n2});
+
+      ns = time_op([&]() {
+        bench_sink = bench_sink + static_cast<double>(fixed.run_to_min(probe, retrieved, rng));
+      }, 1, min_time, reps);
+      report(results, {"fixed_run_to_min", N, P, threads, reps, ns, 2.0 * n2, 8.0 * n2});
+    });
+  }
+
+  // op = one generated probe (written over the previous set as the sweep does)
+  packed_patterns_t hammed;
+  ns = time_op([&]() {
+    fill_hammed_patterns(patterns[0], hammed, 0, BENCH_RUN_PATTERNS, hamming, rng);
+    bench_sink = bench_sink + static_cast<double>(hammed.size());
+  }, BENCH_RUN_PATTERNS, min_time, reps);
+  report(results, {"make_hammed_patterns", N, P, threads, reps, ns, 0.0, n / 4.0});
+
+  // reduced sweep: independent simulations spread over the threads (op = one simulation)
+  const size_t sims = (config.sims > 0) ? config.sims : threads;
+  size_t round = 0;
+  ns = time_op([&]() {
+    int converged = 0;
+    #pragma omp parallel for reduction(+:converged) num_threads(static_cast<int>(threads))
+    for (size_t j = 0; j < sims; j++) {
+      hopfield_t network(N, N);
+      Rng sim_rng = Rng(config.seed).split(N).split(round).split(j);
+      converged += proportion_of_convergence<packed_pattern_t>(network, BENCH_RUN_PATTERNS, hamming, false, 0, P - 1, sim_rng);
+    }
+    round++;
+    bench_sink = bench_sink + converged;
+  }, sims, min_time, reps);
+  report(results, {"proportion_sweep", N, P, threads, reps, ns, 2.0 * n2 * static_cast<double>(P + BENCH_RUN_PATTERNS), 8.0 * n2 * (1.0 + BENCH_RUN_PATTERNS)});
+}
+
+void write_json(std::ostream &out, const BenchConfig &config, const std::vector<BenchResult> &results) {
+  out << "{\n";
+  out << "  \"label\": \"" << config.label << "\",\n";
+  out << "  \"timestamp\": " << static_cast<long long>(std::time(NULL)) << ",\n";
+  out << "  \"seed\": " << config.seed << ",\n";
+  out << "  \"max_threads\": " << omp_get_max_threads() << ",\n";
+  out << "  \"min_time\": " << config.min_time << ",\n";
+  out << "  \"bipolar_kernel\": \"" << bipolar_variant() << "\",\n";
+  out << "  \"results\": [\n";
+  for (size_t r = 0; r < results.size(); r++) {
+    const BenchResult &res = results[r];
+    out << "    {\"kernel\": \"" << res.kernel << "\", \"neurons\": " << res.neurons << ", \"patterns\": " << res.patterns
+        << ", \"threads\": " << res.threads << ", \"reps\": " << res.reps << ", \"ns_per_op\": " << res.ns_per_op
+        << ", \"flops_per_op\": " << res.flops_per_op << ", \"bytes_per_op\": " << res.bytes_per_op
+        << ", \"gflops\": " << (res.flops_per_op / res.ns_per_op) << ", \"bytes_per_sec\": " << (1e9 * res.bytes_per_op / res.ns_per_op)
+        << "}" << ((r + 1 < results.size()) ? "," : "") << "\n";
+  }
+  out << "  ]\n";
+  out << "}" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  BenchConfig config;
+  config.sizes = parse_list(BENCH_DEFAULT_SIZES);
+  config.threads = {1};
+  if (omp_get_max_threads() > 1) {
+    config.threads.push_back(static_cast<size_t>(omp_get_max_threads()));
+  }
+  config.patterns = 0;
+  config.sims = 0;
+  config.min_time = BENCH_MIN_TIME;
+  config.seed = 0x5eed;
+
+  for (int i = 1; i < argc; i += 2) {
+    // every option takes a value
+    static const char *options[] = {"--sizes", "--threads", "--patterns", "--sims", "--min-time", "--seed", "--label", "--out", "--bipolar"};
+    if (std::none_of(std::begin(options), std::end(options), [&](const char *option) { return strcmp(argv[i], option) == 0; })) {
+      std::cerr << "Unknown option " << argv[i] << std::endl;
+      return 1;
+    }
+    if (i + 1 == argc) {
+      std::cerr << "Option " << argv[i] << " needs a value" << std::endl;
+      return 1;
+    }
+    if (strcmp(argv[i], "--sizes") == 0) {
+      config.sizes = parse_list(argv[i + 1]);
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      config.threads = parse_list(argv[i + 1]);
+    } else if (strcmp(argv[i], "--patterns") == 0) {
+      config.patterns = static_cast<size_t>(strtoull(argv[i + 1], NULL, 10));
+    } else if (strcmp(argv[i], "--sims") == 0) {
+      config.sims = static_cast<size_t>(strtoull(argv[i + 1], NULL, 10));
+    } else if (strcmp(argv[i], "--min-time") == 0) {
+      config.min_time = strtod(argv[i + 1], NULL);
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      config.seed = strtoull(argv[i + 1], NULL, 10);
+    } else if (strcmp(argv[i], "--label") == 0) {
+      config.label = argv[i + 1];
+    } else if (strcmp(argv[i], "--out") == 0) {
+      config.out = argv[i + 1];
+    } else if (strcmp(argv[i], "--bipolar") == 0) {
+      if (!bipolar_select(argv[i + 1])) {
+        std::cerr << "Bipolar kernel " << argv[i + 1] << " is not supported on this cpu" << std::endl;
+        return 1;
+      }
+    } else {
+      std::cerr << "Unknown option " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+
+  fprintf(stderr, "bipolar kernel: %s\n", bipolar_variant());
+
+  std::vector<BenchResult> results;
+  for (size_t threads : config.threads) {
+    for (size_t N : config.sizes) {
+      bench_size(config, N, threads, results);
+    }
+  }
+
+  if (config.out.empty()) {
+    write_json(std::cout, config, results);
+  } else {
+    std::ofstream out(config.out);
+    write_json(out, config, results);
+  }
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include "bipolar.hpp"
+#include <cstring>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIPOLAR_X86
+#endif
+
+typedef PackedPattern::word_t word_t;
+typedef double (*bipolar_dot_fn)(const double *, const word_t *, const size_t);
+
+static const uint64_t BIPOLAR_SIGN = 0x8000000000000000ULL;
+
+// flip the sign bit of every weight whose state bit is clear and add
+static double bipolar_dot_portable(const double *w, const word_t *bits, const size_t n) {
+  double acc = 0.0;
+  for (size_t j0 = 0; j0 < n; j0 += PackedPattern::WORD_BITS) {
+    const word_t down = ~bits[j0 / PackedPattern::WORD_BITS];
+    const size_t len = std::min(static_cast<size_t>(PackedPattern::WORD_BITS), n - j0);
+    double hoist = 0.0;
+
+    #pragma omp simd reduction(+:hoist)
+    for (size_t k = 0; k < len; k++) {
+      uint64_t v;
+      std::memcpy(&v, &w[j0 + k], sizeof(v));
+      v ^= ((down >> k) & 1) << 63;
+      double f;
+      std::memcpy(&f, &v, sizeof(f));
+      hoist += f;
+    }
+    acc += hoist;
+  }
+  return acc;
+}
+
+#ifdef BIPOLAR_X86
+
+// 8 weights with the sign flipped where the mask bit is set (masked xor, no multiplies)
+__attribute__((target("avx512f")))
+static inline __m512d bipolar_flip8(const double *w, const __mmask8 down, const __m512i sign) {
+  const __m512i x = _mm512_castpd_si512(_mm512_loadu_pd(w));
+  return _mm512_castsi512_pd(_mm512_mask_xor_epi64(x, down, x, sign));
+}
+
+__attribute__((target("avx512f")))
+static double bipolar_dot_avx512(const double *w, const word_t *bits, const size_t n) {
+  const __m512i sign = _mm512_set1_epi64(static_cast<long long>(BIPOLAR_SIGN));
+  __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+  __m512d acc2 = _mm512_setzero_pd(), acc3 = _mm512_setzero_pd();
+
+  size_t j = 0;
+  for (; j + PackedPattern::WORD_BITS <= n; j += PackedPattern::WORD_BITS) {
+    const word_t down = ~bits[j / PackedPattern::WORD_BITS];
+    const double *wj = w + j;
+    acc0 = _mm512_add_pd(acc0, bipolar_flip8(wj,      static_cast<__mmask8>(down),       sign));
+    acc1 = _mm512_add_pd(acc1, bipolar_flip8(wj + 8,  static_cast<__mmask8>(down >> 8),  sign));
+    acc2 = _mm512_add_pd(acc2, bipolar_flip8(wj + 16, static_cast<__mmask8>(down >> 16), sign));
+    acc3 = _mm512_add_pd(acc3, bipolar_flip8(wj + 24, static_cast<__mmask8>(down >> 24), sign));
+    acc0 = _mm512_add_pd(acc0, bipolar_flip8(wj + 32, static_cast<__mmask8>(down >> 32), sign));
+    acc1 = _mm512_add_pd(acc1, bipolar_flip8(wj + 40, static_cast<__mmask8>(down >> 40), sign));
+    acc2 = _mm512_add_pd(acc2, bipolar_flip8(wj + 48, static_cast<__mmask8>(down >> 48), sign));
+    acc3 = _mm512_add_pd(acc3, bipolar_flip8(wj + 56, static_cast<__mmask8>(down >> 56), sign));
+  }
+
+  // last partial word with masked loads (lanes past n load as zero)
+  for (; j < n; j += 8) {
+    const size_t len = std::min(static_cast<size_t>(8), n - j);
+    const __mmask8 valid = static_cast<__mmask8>((1u << len) - 1);
+    const __mmask8 down = static_cast<__mmask8>(~bits[j / PackedPattern::WORD_BITS] >> (j % PackedPattern::WORD_BITS)) & valid;
+    const __m512i x = _mm512_maskz_loadu_epi64(valid, w + j);
+    acc0 = _mm512_add_pd(acc0, _mm512_castsi512_pd(_mm512_mask_xor_epi64(x, down, x, sign)));
+  }
+
+  double lanes[8];
+  _mm512_storeu_pd(lanes, _mm512_add_pd(_mm512_add_pd(acc0, acc1), _mm512_add_pd(acc2, acc3)));
+  return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+// 4 weights with the sign flipped where the low 4 mask bits are set
+// (bit l of the mask is shifted up into the sign bit of lane l)
+__attribute__((target("avx2")))
+static inline __m256d bipolar_flip4(const double *w, const uint64_t down, const __m256i shifts, const __m256i sign) {
+  const __m256i mask = _mm256_and_si256(_mm256_sllv_epi64(_mm256_set1_epi64x(static_cast<long long>(down)), shifts), sign);
+  return _mm256_castsi256_pd(_mm256_xor_si256(_mm256_castpd_si256(_mm256_loadu_pd(w)), mask));
+}
+
+__attribute__((target("avx2")))
+static double bipolar_dot_avx2(const double *w, const word_t *bits, const size_t n) {
+  const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(BIPOLAR_SIGN));
+  const __m256i shifts = _mm256_set_epi64x(60, 61, 62, 63);
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+
+  size_t j = 0;
+  for (; j + PackedPattern::WORD_BITS <= n; j += PackedPattern::WORD_BITS) {
+    const word_t down = ~bits[j / PackedPattern::WORD_BITS];
+    const double *wj = w + j;
+    for (size_t k = 0; k < PackedPattern::WORD_BITS; k += 16) {
+      acc0 = _mm256_add_pd(acc0, bipolar_flip4(wj + k,      down >> k,        shifts, sign));
+      acc1 = _mm256_add_pd(acc1, bipolar_flip4(wj + k + 4,  down >> (k + 4),  shifts, sign));
+      acc2 = _mm256_add_pd(acc2, bipolar_flip4(wj + k + 8,  down >> (k + 8),  shifts, sign));
+      acc3 = _mm256_add_pd(acc3, bipolar_flip4(wj + k + 12, down >> (k + 12), shifts, sign));
+    }
+  }
+
+  __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+  double lanes[4];
+  _mm256_storeu_pd(lanes, acc);
+  double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+  // last partial word
+  if (j < n) {
+    sum += bipolar_dot_portable(w + j, bits + j / PackedPattern::WORD_BITS, n - j);
+  }
+  return sum;
+}
+
+#endif
+
+struct BipolarKernel {
+  bipolar_dot_fn fn;
+  const char     *name;
+};
+
+static bool bipolar_supported(const char *name) {
+  if (strcmp(name, "portable") == 0) return true;
+#ifdef BIPOLAR_X86
+  __builtin_cpu_init();
+  if (strcmp(name, "avx512") == 0) return __builtin_cpu_supports("avx512f");
+  if (strcmp(name, "avx2") == 0) return __builtin_cpu_supports("avx2");
+#endif
+  return false;
+}
+
+static BipolarKernel bipolar_kernel_named(const char *name) {
+#ifdef BIPOLAR_X86
+  if (strcmp(name, "avx512") == 0) return {bipolar_dot_avx512, "avx512"};
+  if (strcmp(name, "avx2") == 0) return {bipolar_dot_avx2, "avx2"};
+#endif
+  return {bipolar_dot_portable, "portable"};
+}
+
+// widest supported kernel, resolved once on first use
+static BipolarKernel &bipolar_kernel() {
+  static BipolarKernel kernel = bipolar_kernel_named(
+    bipolar_supported("avx512") ? "avx512" : (bipolar_supported("avx2") ? "avx2" : "portable"));
+  return kernel;
+}
+
+bool bipolar_select(const char *name) {
+  if (!bipolar_supported(name)) return false;
+  bipolar_kernel() = bipolar_kernel_named(name);
+  return true;
+}
+
+const char *bipolar_variant() {
+  return bipolar_kernel().name;
+}
+
+template<>
+double bipolar_dot<double>(const double *w, const word_t *bits, const size_t n) {
+  return bipolar_kernel().fn(w, bits, n);
+}
@@ -0,0 +1,33 @@
+#ifndef BIPOLAR_HPP
+#define BIPOLAR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "packed.hpp"
+
+// multiply-free local fields for bipolar states given as packed bits (see PackedPattern)
+//   sum_j w_j s_j = sum_{s_j = +1} w_j - sum_{s_j = -1} w_j
+// so a row is only added with the sign of every weight flipped where the state bit is clear.
+// bits must cover n states (n rounded up to whole words), the bits past n are ignored
+template<typename T>
+T bipolar_dot(const T *w, const PackedPattern::word_t *bits, const size_t n) {
+  T acc = 0;
+  for (size_t j = 0; j < n; j++) {
+    const bool up = (bits[j / PackedPattern::WORD_BITS] >> (j % PackedPattern::WORD_BITS)) & 1;
+    acc += up ? w[j] : -w[j];
+  }
+  return acc;
+}
+
+// double rows dispatch at runtime to the widest kernel the cpu supports
+// (AVX-512 masked xor of the sign bit, AVX2 state bits shifted into the sign bits or the portable loop)
+template<>
+double bipolar_dot<double>(const double *w, const PackedPattern::word_t *bits, const size_t n);
+
+// name of the kernel bipolar_dot<double> dispatches to ("avx512", "avx2" or "portable")
+const char *bipolar_variant();
+
+// force a kernel by name (not thread safe, call before any recall), false if the cpu lacks it
+bool bipolar_select(const char *name);
+
+#endif
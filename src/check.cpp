@@ -0,0 +1,184 @@
+#include "matrix.hpp"
+#include "symmetric.hpp"
+#include "quantized.hpp"
+#include "vector.hpp"
+#include "packed.hpp"
+#include "random.hpp"
+#include "proportion.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <string.h>
+#include <stdlib.h>
+
+// statistical checks of the batched recall engines and the basin radius bisection against per-probe asynchronous recall (run_to_min)
+//   ./check [--sims S] [--seed N]   (make test builds and runs it)
+// every engine has to draw the same distribution of converged probes (or radii) per network as recalling the probes one by one:
+// the means agree within CHECK_SIGMAS standard errors and the standard deviations within a factor CHECK_STD_RATIO,
+// exits 1 after printing every point that does not
+
+#define CHECK_SIMS 400       // networks simulated per point and engine
+#define CHECK_PROBES 100     // probes per network (as the sweep's test_patterns)
+#define CHECK_SIGMAS 4.0
+#define CHECK_STD_RATIO 1.3
+#define CHECK_RADIUS_THRESHOLD 0.5  // as the default radius_threshold
+
+// a network of neurons trained on a random original plus train_patterns random patterns, probed hamming away from the original
+struct CheckPoint {
+  size_t neurons, train_patterns, hamming;
+};
+
+static const CheckPoint check_points[] = {
+  {50, 0, 25},    // rank one weights and half the neurons flipped, every probe is a fair coin
+  {50, 3, 10},
+  {100, 5, 20},
+  {100, 8, 35},
+  {256, 10, 60}
+};
+
+// basin radii are bisected up to hamming = N / 2 (the default hamming_max)
+static const CheckPoint radius_points[] = {
+  {50, 0, 25},    // every bisection ends at 24 or 25 (half the probes converge at 25 on average)
+  {50, 3, 25},
+  {100, 5, 50},
+  {100, 8, 50}
+};
+
+struct Moments {
+  double mean, std;
+};
+
+static Moments moments(const std::vector<int> &counts) {
+  const double n = static_cast<double>(counts.size());
+  double mean = 0.0;
+  for (int c : counts) {
+    mean += c;
+  }
+  mean /= n;
+
+  double sum = 0.0;
+  for (int c : counts) {
+    sum += (c - mean) * (c - mean);
+  }
+  return {mean, std::sqrt(sum / (n - 1.0))};
+}
+
+// converged probes of every simulated network (weights H), recall(hopfield, pattern, hamming, rng) counts them for one
+// (a seed trains the same networks on the same patterns whatever the weights)
+template<typename H, typename Fn>
+static std::vector<int> simulate(const CheckPoint &point, const size_t sims, const uint64_t seed, Fn recall) {
+  std::vector<int> counts(sims);
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t j = 0; j < sims; j++) {
+    Rng rng = Rng(seed).split(point.neurons).split(j);
+    H hopfield(point.neurons);
+    packed_pattern_t pattern(point.neurons);
+    train_network(hopfield, pattern, false, 0, point.train_patterns, rng);
+    counts[j] = recall(hopfield, pattern, point.hamming, rng);
+  }
+  return counts;
+}
+
+// the reference: one asynchronous Recall per probe
+static int recall_each(const hopfield_t &hopfield, const packed_pattern_t &pattern, const size_t hamming, Rng &rng) {
+  packed_patterns_t probes;
+  make_hammed_patterns(pattern, probes, CHECK_PROBES, hamming, false, rng);
+
+  int converged = 0;
+  packed_pattern_t out(pattern.num_rows());
+  for (const packed_pattern_t &probe : probes) {
+    hopfield.run_to_min(probe, out, rng);
+    converged += out.similar(pattern) ? 1 : 0;
+  }
+  return converged;
+}
+
+// the same probes recalled in batches (BatchRecall lockstep)
+static int recall_batch(const hopfield_t &hopfield, const packed_pattern_t &pattern, const size_t hamming, Rng &rng) {
+  packed_patterns_t probes, out;
+  make_hammed_patterns(pattern, probes, CHECK_PROBES, hamming, false, rng);
+  hopfield.run_batch_to_min(probes, out, false, rng);
+
+  int converged = 0;
+  for (const packed_pattern_t &retrieved : out) {
+    converged += retrieved.similar(pattern) ? 1 : 0;
+  }
+  return converged;
+}
+
+// the probes of the sweep, flip lists recalled from the fields of the original (count_converged, BatchRecall::run_hammed)
+template<typename H>
+static int recall_hammed(const H &hopfield, const packed_pattern_t &pattern, const size_t hamming, Rng &rng) {
+  return count_converged(hopfield, pattern, CHECK_PROBES, hamming, rng);
+}
+
+// critical radius bisected with count_converged (basin_radius as --radius runs it)
+template<typename H>
+static int radius_hammed(const H &hopfield, const packed_pattern_t &pattern, const size_t max_hamming, Rng &rng) {
+  size_t evaluations = 0;
+  return static_cast<int>(basin_radius(hopfield, pattern, CHECK_PROBES, max_hamming, CHECK_RADIUS_THRESHOLD, evaluations, rng));
+}
+
+// the same bisection over one asynchronous Recall per probe
+static int radius_each(const hopfield_t &hopfield, const packed_pattern_t &pattern, const size_t max_hamming, Rng &rng) {
+  size_t evaluations = 0;
+  return static_cast<int>(bisect_radius([&](const size_t hamming) {
+    return recall_each(hopfield, pattern, hamming, rng);
+  }, CHECK_PROBES, max_hamming, CHECK_RADIUS_THRESHOLD, evaluations));
+}
+
+// compare the distribution of an engine with the reference at one point, false (after printing both) when they differ
+static bool compare(const std::string &engine, const CheckPoint &point, const std::vector<int> &reference, const std::vector<int> &counts) {
+  const Moments a = moments(reference);
+  const Moments b = moments(counts);
+  const double n = static_cast<double>(counts.size());
+  const double stderr_diff = std::sqrt((a.std * a.std + b.std * b.std) / n);
+
+  // a point whose probes (almost) all converge or all fail has no spread to compare
+  const bool mean_ok = std::fabs(a.mean - b.mean) <= CHECK_SIGMAS * stderr_diff + 1e-9;
+  const bool std_ok = (a.std < 0.2 && b.std < 0.2) || (b.std <= CHECK_STD_RATIO * a.std && a.std <= CHECK_STD_RATIO * b.std);
+
+  fprintf(stderr, "%-4s %-16s N=%-5zu P=%-4zu hamming=%-4zu mean %8.3f / %8.3f  std %7.3f / %7.3f\n",
+    (mean_ok && std_ok) ? "ok" : "FAIL", engine.c_str(), point.neurons, point.train_patterns, point.hamming, b.mean, a.mean, b.std, a.std);
+  return mean_ok && std_ok;
+}
+
+int main(int argc, char* argv[]) {
+  size_t sims = CHECK_SIMS;
+  uint64_t seed = 0x5eed;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 == argc) {
+      std::cerr << "Option " << argv[i] << " needs a value" << std::endl;
+      return 1;
+    }
+    if (strcmp(argv[i], "--sims") == 0) {
+      sims = static_cast<size_t>(strtoull(argv[i + 1], NULL, 10));
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      seed = strtoull(argv[i + 1], NULL, 10);
+    } else {
+      std::cerr << "Unknown option " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  if (sims < 2) {
+    std::cerr << "--sims has to be at least 2" << std::endl;
+    return 1;
+  }
+
+  // (engine value / reference value in every line)
+  bool ok = true;
+  for (const CheckPoint &point : check_points) {
+    const std::vector<int> reference = simulate<hopfield_t>(point, sims, seed, recall_each);
+    ok = compare("batch lockstep", point, reference, simulate<hopfield_t>(point, sims, seed, recall_batch)) && ok;
+    ok = compare("hammed dense", point, reference, simulate<hopfield_t>(point, sims, seed, recall_hammed<hopfield_t>)) && ok;
+    ok = compare("hammed symmetric", point, reference, simulate<sym_hopfield_t>(point, sims, seed, recall_hammed<sym_hopfield_t>)) && ok;
+    ok = compare("hammed quantized", point, reference, simulate<quant_hopfield_t>(point, sims, seed, recall_hammed<quant_hopfield_t>)) && ok;
+  }
+  for (const CheckPoint &point : radius_points) {
+    const std::vector<int> reference = simulate<hopfield_t>(point, sims, seed, radius_each);
+    ok = compare("radius", point, reference, simulate<hopfield_t>(point, sims, seed, radius_hammed<hopfield_t>)) && ok;
+  }
+  return ok ? 0 : 1;
+}
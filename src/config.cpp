@@ -0,0 +1,273 @@
+#include "config.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+SweepConfig::SweepConfig()
+    : neurons({50, 150, 250, 350}), train_patterns_max(0), train_patterns_steps(20), hamming_max(0.5), hamming_steps(100),
+      test_patterns(100), simulations(200), batch(10), ci_width(0.0), simulations_min(20), radius_threshold(0.5),
+      mode(SWEEP_FRESH), weights(WEIGHTS_DENSE), connectivity(CONNECT_RANDOM), dilution(0.1), neighbours(10), fixed_kernels(true), bipolar("auto"), checkpoint_seconds(60) {}
+
+size_t SweepConfig::max_train_patterns(const size_t num_neurons) const {
+  if (train_patterns_max > 0) return train_patterns_max;
+  // absolute max for Hebb which is N / sqrt(2 * ln(N))
+  return static_cast<size_t>(std::ceil(static_cast<double>(num_neurons) / (2.0 * std::log(static_cast<double>(num_neurons)))));
+}
+
+size_t SweepConfig::train_patterns_step(const size_t num_neurons) const {
+  return static_cast<size_t>(std::max(1.0, max_train_patterns(num_neurons) / static_cast<double>(train_patterns_steps)));
+}
+
+size_t SweepConfig::max_hamming(const size_t num_neurons) const {
+  return static_cast<size_t>(num_neurons * hamming_max);
+}
+
+size_t SweepConfig::hamming_step(const size_t num_neurons) const {
+  return static_cast<size_t>(std::max(1.0, num_neurons * hamming_max / static_cast<double>(hamming_steps)));
+}
+
+static void config_error(const std::string &where, const std::string &what) {
+  std::cerr << "Bad sweep setting (" << where << "): " << what << std::endl;
+  std::exit(1);
+}
+
+static size_t parse_size(const std::string &key, const std::string &value, const std::string &where) {
+  char *end = NULL;
+  unsigned long long parsed = strtoull(value.c_str(), &end, 10);
+  if (value.empty() || value[0] == '-' || *end != '\0') {
+    config_error(where, key + " = " + value + " is not a count");
+  }
+  return static_cast<size_t>(parsed);
+}
+
+static double parse_double(const std::string &key, const std::string &value, const std::string &where) {
+  char *end = NULL;
+  double parsed = strtod(value.c_str(), &end);
+  if (value.empty() || *end != '\0' || !std::isfinite(parsed)) {
+    config_error(where, key + " = " + value + " is not a number");
+  }
+  return parsed;
+}
+
+// min:max:step (max excluded, as the sweep always ran) or a list of sizes
+static std::vector<size_t> parse_neurons(const std::string &value, const std::string &where) {
+  std::vector<size_t> sizes;
+  size_t min, max, step;
+  char rest;
+  if (sscanf(value.c_str(), "%zu:%zu:%zu%c", &min, &max, &step, &rest) == 3) {
+    if (step == 0) {
+      config_error(where, "neurons = " + value + " has a zero step");
+    }
+    for (size_t n = min; n < max; n += step) {
+      sizes.push_back(n);
+    }
+    return sizes;
+  }
+
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    sizes.push_back(parse_size("neurons", item, where));
+  }
+  return sizes;
+}
+
+bool set_sweep_option(SweepConfig &config, const std::string &key, const std::string &value, const std::string &where) {
+  std::string name = key;
+  std::replace(name.begin(), name.end(), '-', '_');
+
+  if (name == "neurons") {
+    config.neurons = parse_neurons(value, where);
+  } else if (name == "train_patterns_max") {
+    config.train_patterns_max = value == "auto" ? 0 : parse_size(name, value, where);
+  } else if (name == "train_patterns_steps") {
+    config.train_patterns_steps = parse_size(name, value, where);
+  } else if (name == "hamming_max") {
+    config.hamming_max = parse_double(name, value, where);
+  } else if (name == "hamming_steps") {
+    config.hamming_steps = parse_size(name, value, where);
+  } else if (name == "test_patterns") {
+    config.test_patterns = parse_size(name, value, where);
+  } else if (name == "simulations") {
+    config.simulations = parse_size(name, value, where);
+  } else if (name == "batch") {
+    config.batch = parse_size(name, value, where);
+  } else if (name == "ci_width") {
+    config.ci_width = parse_double(name, value, where);
+  } else if (name == "simulations_min") {
+    config.simulations_min = parse_size(name, value, where);
+  } else if (name == "radius_threshold") {
+    config.radius_threshold = parse_double(name, value, where);
+  } else if (name == "mode") {
+    if (value == "fresh") {
+      config.mode = SWEEP_FRESH;
+    } else if (value == "grown") {
+      config.mode = SWEEP_GROWN;
+    } else if (value == "shared") {
+      config.mode = SWEEP_SHARED;
+    } else {
+      config_error(where, "mode = " + value + " (fresh, grown or shared)");
+    }
+  } else if (name == "weights") {
+    if (value == "dense") {
+      config.weights = WEIGHTS_DENSE;
+    } else if (value == "symmetric") {
+      config.weights = WEIGHTS_SYMMETRIC;
+    } else if (value == "quantized") {
+      config.weights = WEIGHTS_QUANTIZED;
+    } else if (value == "sparse") {
+      config.weights = WEIGHTS_SPARSE;
+    } else {
+      config_error(where, "weights = " + value + " (dense, symmetric, quantized or sparse)");
+    }
+  } else if (name == "connectivity") {
+    if (value == "random") {
+      config.connectivity = CONNECT_RANDOM;
+    } else if (value == "nearest") {
+      config.connectivity = CONNECT_NEAREST;
+    } else {
+      config_error(where, "connectivity = " + value + " (random or nearest)");
+    }
+  } else if (name == "dilution") {
+    config.dilution = parse_double(name, value, where);
+  } else if (name == "neighbours") {
+    config.neighbours = parse_size(name, value, where);
+  } else if (name == "fixed_kernels") {
+    config.fixed_kernels = parse_size(name, value, where) != 0;
+  } else if (name == "bipolar") {
+    config.bipolar = value;
+  } else if (name == "network") {
+    config.network = value == "none" ? "" : value;
+  } else if (name == "checkpoint_seconds") {
+    config.checkpoint_seconds = parse_size(name, value, where);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static std::string trim(const std::string &s) {
+  const char *space = " \t\r";
+  size_t first = s.find_first_not_of(space);
+  if (first == std::string::npos) return "";
+  return s.substr(first, s.find_last_not_of(space) - first + 1);
+}
+
+void read_sweep_config(const std::string &path, SweepConfig &config) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Cannot read sweep config " << path << std::endl;
+    std::exit(1);
+  }
+
+  std::string line;
+  for (size_t number = 1; std::getline(in, line); number++) {
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty()) continue;
+
+    const std::string where = path + ":" + std::to_string(number);
+    size_t eq = line.find('=');
+    if (eq == std::string::npos) {
+      config_error(where, "expected key = value, got " + line);
+    }
+    const std::string key = trim(line.substr(0, eq));
+    if (!set_sweep_option(config, key, trim(line.substr(eq + 1)), where)) {
+      config_error(where, "unknown key " + key);
+    }
+  }
+}
+
+void check_sweep_config(const SweepConfig &config) {
+  const std::string where = "sweep config";
+  if (config.neurons.empty()) {
+    config_error(where, "no network sizes");
+  }
+  for (size_t n : config.neurons) {
+    if (n < 2 || n > UINT32_MAX) {
+      config_error(where, "networks need 2 to 2^32 - 1 neurons, got " + std::to_string(n));
+    }
+  }
+  if (config.train_patterns_steps == 0 || config.hamming_steps == 0) {
+    config_error(where, "train_patterns_steps and hamming_steps have to be at least 1");
+  }
+  if (!(config.hamming_max >= 0.0 && config.hamming_max <= 1.0)) {
+    config_error(where, "hamming_max is a proportion of the neurons (0 to 1)");
+  }
+  if (config.test_patterns == 0 || config.test_patterns > 0xffff) {
+    config_error(where, "test_patterns has to be 1 to 65535 (the journal stores the converged counts as 16 bits)");
+  }
+  if (config.simulations == 0 || config.batch == 0 || config.simulations_min == 0) {
+    config_error(where, "simulations, simulations_min and batch have to be at least 1");
+  }
+  if (config.ci_width < 0.0) {
+    config_error(where, "ci_width can not be negative");
+  }
+  if (!(config.radius_threshold > 0.0 && config.radius_threshold <= 1.0)) {
+    config_error(where, "radius_threshold is a proportion of the test patterns (above 0, at most 1)");
+  }
+  if (config.weights == WEIGHTS_SPARSE && config.connectivity == CONNECT_RANDOM && !(config.dilution > 0.0 && config.dilution <= 1.0)) {
+    config_error(where, "dilution is a connection probability (above 0, at most 1)");
+  }
+  if (config.weights == WEIGHTS_SPARSE && config.connectivity == CONNECT_NEAREST && config.neighbours < 2) {
+    config_error(where, "neighbours has to be at least 2 (one on each side)");
+  }
+  if (config.ci_width > 0.0 && config.mode != SWEEP_FRESH) {
+    config_error(where, "adaptive sampling (ci_width) is only supported for fresh networks");
+  }
+  if (config.mode == SWEEP_GROWN && config.weights == WEIGHTS_SPARSE) {
+    config_error(where, "grown networks are only supported for fully connected networks");
+  }
+  if (!config.network.empty() && (config.mode != SWEEP_FRESH || config.weights != WEIGHTS_DENSE)) {
+    config_error(where, "a stored network (network = " + config.network + ") has dense weights and is probed as fresh networks");
+  }
+}
+
+uint64_t result_settings(const SweepConfig &config) {
+  uint64_t dilution = 0, width = 0;
+  if (config.weights == WEIGHTS_SPARSE && config.connectivity == CONNECT_RANDOM) {
+    std::memcpy(&dilution, &config.dilution, sizeof(dilution));
+  }
+  std::memcpy(&width, &config.ci_width, sizeof(width));
+
+  // adaptive batches are as big as batch and start after simulations_min
+  uint64_t settings = dilution;
+  settings = settings * 1099511628211ULL ^ width;
+  if (config.weights == WEIGHTS_SPARSE && config.connectivity == CONNECT_NEAREST) {
+    settings = settings * 1099511628211ULL ^ (config.neighbours + 1);
+  }
+  if (config.ci_width > 0.0) {
+    settings = settings * 1099511628211ULL ^ config.simulations_min;
+    settings = settings * 1099511628211ULL ^ config.batch;
+  }
+
+  // probes of a stored network are told apart by its name
+  for (char c : config.network) {
+    settings = settings * 1099511628211ULL ^ static_cast<unsigned char>(c);
+  }
+  return settings;
+}
+
+std::string describe_sweep_config(const SweepConfig &config) {
+  static const char *modes[] = {"fresh", "grown", "shared"};
+  std::stringstream out;
+  out << "neurons";
+  for (size_t i = 0; i < config.neurons.size(); i++) {
+    out << (i == 0 ? " " : ",") << config.neurons[i];
+  }
+  out << ", trained patterns below " << (config.train_patterns_max > 0 ? std::to_string(config.train_patterns_max) : "N / (2 ln N)")
+      << " in " << config.train_patterns_steps << " steps, hamming up to " << config.hamming_max << " N in " << config.hamming_steps << " steps, "
+      << config.test_patterns << " test patterns, " << config.simulations << " simulations";
+  if (config.ci_width > 0.0) {
+    out << " (at least " << config.simulations_min << " until the confidence interval is below " << config.ci_width << ")";
+  }
+  out << ", " << modes[config.mode] << " networks";
+  if (!config.network.empty()) {
+    out << " (probing the stored network " << config.network << ")";
+  }
+  return out.str();
+}
@@ -0,0 +1,103 @@
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// how the simulations of the grid are organized
+enum SweepMode {
+  SWEEP_FRESH,   // every (point, simulation) trains its own network
+  SWEEP_GROWN,   // one network per simulation grows along the trained patterns axis
+  SWEEP_SHARED   // one network per simulation is probed at every hamming distance
+};
+
+// weights of the simulated networks
+enum WeightType {
+  WEIGHTS_DENSE,      // full N x N doubles (FixedMatrix<N> for the FIXED_SIZES when fixed_kernels is set)
+  WEIGHTS_SYMMETRIC,  // tiles of the upper triangle only (SymMatrix), half the weight memory and traffic
+  WEIGHTS_QUANTIZED,  // exact integer Hebbian sums in the narrowest of int8/int16/int32 (QuantMatrix)
+  WEIGHTS_SPARSE      // diluted CSR weights (SparseMatrix), every simulation draws its own connectivity
+};
+
+// connections of sparse weights
+enum Connectivity {
+  CONNECT_RANDOM,   // every pair connected with probability dilution, drawn per simulation
+  CONNECT_NEAREST   // ring lattice of the neighbours nearest neurons (half on each side)
+};
+
+// parameters of a proportion sweep or radius run, read at startup so changing the experiment needs no
+// rebuild: the defaults below, then a config file (--config path), then command line flags (--key value).
+// a config file holds one "key = value" per line, # starts a comment, keys are the names of the fields
+// (with '_' or '-'), e.g.
+//   neurons = 50:450:100     # min:max:step (max excluded) or a list 64,128,1024
+//   simulations = 200
+//   weights = quantized
+struct SweepConfig {
+  std::vector<size_t> neurons;  // network sizes (50:450:100)
+
+  // trained patterns run from 0 below train_patterns_max (0: the Hebbian capacity N / (2 ln N) of every size)
+  // in steps of about train_patterns_max / train_patterns_steps (at least 1)
+  size_t train_patterns_max;    // 0
+  size_t train_patterns_steps;  // 20
+
+  // test distances run from 0 to hamming_max * N in steps of about hamming_max * N / hamming_steps (at least 1)
+  double hamming_max;           // 0.5
+  size_t hamming_steps;         // 100
+
+  size_t test_patterns;         // test patterns probed per simulation (100)
+  size_t simulations;           // simulations of every grid point (200), the most when sampling adaptively
+  size_t batch;                 // simulations of a grid point scheduled as one task (10)
+
+  // sequential sampling: start every grid point with simulations_min simulations and keep adding batches until
+  // the 95% confidence interval of its mean proportion is narrower than ci_width (in converged test patterns,
+  // as the mean column) or simulations have run (0 samples every point fully)
+  double ci_width;              // 0
+  size_t simulations_min;       // 20
+
+  // basin radius mode (--radius): the largest hamming distance at which at least this proportion of the
+  // test patterns still converges, every (neurons, trained patterns) pair bisects simulations networks for it
+  double radius_threshold;      // 0.5
+
+  SweepMode mode;               // fresh|grown|shared (fresh)
+  WeightType weights;           // dense|symmetric|quantized|sparse (dense)
+  Connectivity connectivity;    // random|nearest connections of sparse weights (random)
+  double dilution;              // connection probability of random sparse weights (0.1)
+  size_t neighbours;            // connections per neuron of nearest sparse weights (10)
+  bool fixed_kernels;           // run dense weights of the FIXED_SIZES on FixedMatrix<N> (1)
+  std::string bipolar;          // kernel of the packed bipolar fields, auto|avx512|avx2|portable (auto)
+
+  // base name of a network written by --save-network: every simulation probes one of its trained patterns
+  // instead of training a network, the run has its size and trained patterns (fresh dense sweeps and --radius)
+  std::string network;          // none
+
+  // the journal and the rows written so far are synced to disk this often
+  size_t checkpoint_seconds;    // 60
+
+  SweepConfig();
+
+  // the trained patterns and test distances of the grid of a network size
+  size_t max_train_patterns(const size_t num_neurons) const;
+  size_t train_patterns_step(const size_t num_neurons) const;
+  size_t max_hamming(const size_t num_neurons) const;
+  size_t hamming_step(const size_t num_neurons) const;
+};
+
+// set the field named key from value, false when there is no such field (a bad value exits naming where from)
+bool set_sweep_option(SweepConfig &config, const std::string &key, const std::string &value, const std::string &where);
+
+// apply every line of the config file at path
+void read_sweep_config(const std::string &path, SweepConfig &config);
+
+// exit naming the problem unless the settings can run together
+void check_sweep_config(const SweepConfig &config);
+
+// the settings besides the grid that change what a sweep finds (folded into its journal, so a sweep is
+// neither resumed nor merged under different ones)
+uint64_t result_settings(const SweepConfig &config);
+
+// one line summary of the grid and sampling settings
+std::string describe_sweep_config(const SweepConfig &config);
+
+#endif
@@ -0,0 +1,181 @@
+#include "fixed.hpp"
+#include "recall.hpp"
+#include "arena.hpp"
+#include "util.hpp"
+#include <algorithm>
+
+// w_ij = keep * w_ij + scale * (x_i . x_j) for i != j and w_ii = 0 with
+// x_i . x_j = P - 2 * popcount(bits_i ^ bits_j) (as Matrix::hebbian, the specialized
+// sizes fit in cache so the upper triangle is computed in one pass and then mirrored)
+template<size_t N>
+void FixedMatrix<N>::hebbian(const packed_patterns_t &patterns, const double keep, const double scale) {
+  INSTR_COUNT(INSTR_TRAININGS, 1);
+
+  Scratch<PackedPattern::word_t, SCRATCH_BITS> bits_lease;
+  std::vector<PackedPattern::word_t> &bits = *bits_lease;
+  const size_t pw = transpose_patterns(patterns, bits);
+  const double pattern_n = static_cast<double>(patterns.size());
+
+  for (size_t i = 0; i < N; i++) {
+    const PackedPattern::word_t *xi = &bits[i * pw];
+    double *row = row_ptr(i);
+    row[i] = 0.0;
+
+    for (size_t j = i + 1; j < N; j++) {
+      const PackedPattern::word_t *xj = &bits[j * pw];
+      long diff = 0;
+      for (size_t w = 0; w < pw; w++) {
+        diff += __builtin_popcountll(xi[w] ^ xj[w]);
+      }
+      const double dot = pattern_n - 2.0 * static_cast<double>(diff);
+      row[j] = ((keep == 0.0) ? 0.0 : keep * row[j]) + scale * dot;
+    }
+  }
+
+  // mirror into the lower triangle
+  for (size_t i = 1; i < N; i++) {
+    double *row = row_ptr(i);
+    for (size_t j = 0; j < i; j++) {
+      row[j] = storage_[j * stride + i];
+    }
+  }
+}
+
+template<size_t N>
+void FixedMatrix<N>::train_on(patterns_t &patterns) {
+  // pack into bits and use the popcount kernel
+  packed_patterns_t packed;
+  packed.reserve(patterns.size());
+  for (size_t p = 0; p < patterns.size(); ++p) {
+    packed.push_back(PackedPattern(patterns.at(p)));
+  }
+  train_on(packed);
+}
+
+// Hebb's rule W = X^T X / P with a zero diagonal (overwrites the weights)
+template<size_t N>
+void FixedMatrix<N>::train_on(packed_patterns_t &patterns) {
+  if (patterns.empty()) {
+    zeroize();
+    return;
+  }
+
+  hebbian(patterns, 0.0, 1.0 / static_cast<double>(patterns.size()));
+  num_patterns_ = patterns.size();
+}
+
+template<size_t N>
+void FixedMatrix<N>::add_pattern(const packed_pattern_t &pattern) {
+  add_patterns(packed_patterns_t(1, pattern));
+}
+
+// W' = (P W + X^T X) / (P + dP)
+template<size_t N>
+void FixedMatrix<N>::add_patterns(const packed_patterns_t &patterns) {
+  if (patterns.empty()) return;
+
+  const double old_n = static_cast<double>(num_patterns_);
+  const double new_n = static_cast<double>(num_patterns_ + patterns.size());
+  hebbian(patterns, old_n / new_n, 1.0 / new_n);
+  num_patterns_ += patterns.size();
+}
+
+template<size_t N>
+void FixedMatrix<N>::remove_pattern(const packed_pattern_t &pattern) {
+  remove_patterns(packed_patterns_t(1, pattern));
+}
+
+// W' = (P W - X^T X) / (P - dP), unlearning every pattern leaves zero weights
+template<size_t N>
+void FixedMatrix<N>::remove_patterns(const packed_patterns_t &patterns) {
+  if (patterns.empty()) return;
+  if (patterns.size() > num_patterns_) {
+    std::cerr << "Cannot remove " << patterns.size() << " patterns from a network trained on " << num_patterns_ << std::endl;
+    std::exit(1);
+  }
+
+  if (patterns.size() == num_patterns_) {
+    zeroize();
+    return;
+  }
+
+  const double old_n = static_cast<double>(num_patterns_);
+  const double new_n = static_cast<double>(num_patterns_ - patterns.size());
+  hebbian(patterns, old_n / new_n, -1.0 / new_n);
+  num_patterns_ -= patterns.size();
+}
+
+// synchronous update on the padded states
+template<size_t N>
+pattern_t FixedMatrix<N>::update(const pattern_t &pattern) const {
+  alignas(FIXED_ALIGN) double s[stride] = {};
+  for (size_t i = 0; i < N; i++) {
+    s[i] = static_cast<double>(pattern(i));
+  }
+
+  pattern_t out(N);
+  for (size_t i = 0; i < N; i++) {
+    const double *row = row_ptr(i);
+    double h = 0.0;
+
+    #pragma omp simd aligned(row, s : FIXED_ALIGN) reduction(+:h)
+    for (size_t j = 0; j < stride; j++) {
+      h += row[j] * s[j];
+    }
+
+    if (dcompare(h, 0.0)) {
+      out(i) = pattern(i); // copy previous state
+    } else {
+      out(i) = vsign<double, short>(h); // get -1/1 sign
+    }
+  }
+  INSTR_COUNT(INSTR_MATVECS, 1);
+  return out;
+}
+
+// recall runs the generic engines (recall.hpp) on the fixed size kernels
+template<size_t N>
+size_t FixedMatrix<N>::run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng) const {
+  Recall<FixedMatrix<N>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
+
+  return steps;
+}
+
+template<size_t N>
+size_t FixedMatrix<N>::run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng) const {
+  Recall<FixedMatrix<N>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
+
+  return steps;
+}
+
+template<size_t N>
+size_t FixedMatrix<N>::run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<FixedMatrix<N>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
+
+template<size_t N>
+size_t FixedMatrix<N>::run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<FixedMatrix<N>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
+
+bool has_fixed_kernel(const size_t N) {
+  #define FIXED_CASE(n) case n: return true;
+  switch (N) {
+    FIXED_SIZES(FIXED_CASE)
+    default: return false;
+  }
+  #undef FIXED_CASE
+}
+
+// force declarations of the following templates
+#define FIXED_INSTANTIATE(n) template class FixedMatrix<n>;
+FIXED_SIZES(FIXED_INSTANTIATE)
+#undef FIXED_INSTANTIATE
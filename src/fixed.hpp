@@ -0,0 +1,204 @@
+#ifndef FIXED_HPP
+#define FIXED_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include "matrix.hpp"
+#include "vector.hpp"
+#include "packed.hpp"
+#include "bipolar.hpp"
+#include "random.hpp"
+#include "instrument.hpp"
+#include "util.hpp"
+
+// byte alignment of every weight row (a cache line, and a full AVX-512 vector)
+#define FIXED_ALIGN 64
+
+// neuron counts with a compiled in specialization (the sizes of the default sweep)
+#define FIXED_SIZES(X) X(50) X(150) X(250) X(350)
+
+// fully connected double weights for exactly N neurons. Every loop bound is a compile time
+// constant so the kernels are unrolled and vectorized with their remainders resolved statically,
+// rows are padded with zeros to a multiple of FIXED_ALIGN bytes and start on such a boundary,
+// so kernels on padded states (energy, update) run whole aligned vectors only.
+// Same interface as Matrix
+template<size_t N>
+class FixedMatrix {
+public:
+  static const size_t stride = (N * sizeof(double) + FIXED_ALIGN - 1) / FIXED_ALIGN * FIXED_ALIGN / sizeof(double);
+
+  FixedMatrix() : num_patterns_(0), storage_(nullptr) {
+    if (posix_memalign(reinterpret_cast<void**>(&storage_), FIXED_ALIGN, N * stride * sizeof(double)) != 0) {
+      std::cerr << "Could not allocate " << N << "x" << N << " fixed weights" << std::endl;
+      std::exit(1);
+    }
+    std::memset(storage_, 0, N * stride * sizeof(double));
+  }
+
+  // same shape arguments as Matrix so it can stand in for hopfield_t
+  FixedMatrix(size_t n) : FixedMatrix() {
+    if (n != N) {
+      std::cerr << "Fixed weights are compiled for " << N << " neurons, got " << n << std::endl;
+      std::exit(1);
+    }
+  }
+
+  ~FixedMatrix() { free(storage_); }
+  FixedMatrix(const FixedMatrix &) = delete;
+  FixedMatrix &operator=(const FixedMatrix &) = delete;
+
+  const double& operator()(size_t i, size_t j) const { return storage_[i * stride + j]; }
+
+  void zeroize() {
+    std::memset(storage_, 0, N * stride * sizeof(double));
+    num_patterns_ = 0;
+  }
+
+  // E = -1/2 sum_i s_i (W s)_i over the padded rows
+  template<typename P>
+  double energy(const P &pattern) const {
+    INSTR_COUNT(INSTR_ENERGY_EVALS, 1);
+    alignas(FIXED_ALIGN) double s[stride] = {};
+    for (size_t i = 0; i < N; i++) {
+      s[i] = static_cast<double>(pattern(i));
+    }
+
+    double e = 0.0;
+    for (size_t i = 0; i < N; i++) {
+      const double *row = row_ptr(i);
+      double hoist = 0.0;
+
+      #pragma omp simd aligned(row, s : FIXED_ALIGN) reduction(+:hoist)
+      for (size_t j = 0; j < stride; j++) {
+        hoist += row[j] * s[j];
+      }
+      e -= s[i] * hoist;
+    }
+    return 0.5 * e;
+  }
+
+  // local fields h = W x for every neuron (x is copied into a padded aligned state
+  // so every row is whole aligned vectors)
+  template<typename F>
+  void fields(const F *x, F *h) const {
+    alignas(FIXED_ALIGN) F s[stride] = {};
+    std::copy(x, x + N, s);
+
+    for (size_t i = 0; i < N; i++) {
+      const double *row = row_ptr(i);
+      F hoist = 0.0;
+
+      #pragma omp simd aligned(row, s : FIXED_ALIGN) reduction(+:hoist)
+      for (size_t j = 0; j < stride; j++) {
+        hoist += static_cast<F>(row[j]) * s[j];
+      }
+      h[i] = hoist;
+    }
+  }
+
+  // local fields from packed -1/1 states (multiply-free, see bipolar.hpp)
+  template<typename F>
+  void fields(const PackedPattern &s, F *h) const {
+    for (size_t i = 0; i < N; i++) {
+      h[i] = static_cast<F>(bipolar_dot(row_ptr(i), s.words(), N));
+    }
+  }
+
+  // fields of a batch of probes h[b * ld + i], 4 probes at a time are copied into padded aligned
+  // states and every weight row is reused for all of them (the whole matrix of the specialized
+  // sizes stays in cache so it is not blocked)
+  template<typename F>
+  void fields_batch(const F *x, F *h, const size_t count, const size_t ld) const {
+    alignas(FIXED_ALIGN) F s[4][stride] = {};
+
+    size_t b = 0;
+    for (; b + 4 <= count; b += 4) {
+      for (size_t k = 0; k < 4; k++) {
+        std::copy(x + (b + k) * ld, x + (b + k) * ld + N, s[k]);
+      }
+      const F *x0 = s[0], *x1 = s[1], *x2 = s[2], *x3 = s[3];
+
+      for (size_t i = 0; i < N; i++) {
+        const double *row = row_ptr(i);
+        F a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0;
+
+        #pragma omp simd aligned(row, x0, x1, x2, x3 : FIXED_ALIGN) reduction(+:a0,a1,a2,a3)
+        for (size_t j = 0; j < stride; j++) {
+          const F w = static_cast<F>(row[j]);
+          a0 += w * x0[j];
+          a1 += w * x1[j];
+          a2 += w * x2[j];
+          a3 += w * x3[j];
+        }
+        h[b * ld + i] = a0;
+        h[(b + 1) * ld + i] = a1;
+        h[(b + 2) * ld + i] = a2;
+        h[(b + 3) * ld + i] = a3;
+      }
+    }
+
+    for (; b < count; b++) {
+      fields(x + b * ld, h + b * ld);
+    }
+  }
+
+  // h += scale * W[:, k] (symmetric so the column is row k)
+  template<typename F>
+  void add_column(size_t k, const F &scale, F *h) const {
+    const double *col = row_ptr(k);
+
+    #pragma omp simd aligned(col : FIXED_ALIGN)
+    for (size_t j = 0; j < N; j++) {
+      h[j] += scale * static_cast<F>(col[j]);
+    }
+  }
+
+  void train_on(patterns_t &patterns);
+  void train_on(packed_patterns_t &patterns);
+  void add_pattern(const packed_pattern_t &pattern);
+  void add_patterns(const packed_patterns_t &patterns);
+  void remove_pattern(const packed_pattern_t &pattern);
+  void remove_patterns(const packed_patterns_t &patterns);
+
+  pattern_t update(const pattern_t &pattern) const;
+  size_t run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+
+  size_t num_rows() const { return N; }
+  size_t num_cols() const { return N; }
+  size_t num_patterns() const { return num_patterns_; }
+
+private:
+  const double *row_ptr(size_t i) const { return static_cast<const double*>(__builtin_assume_aligned(storage_ + i * stride, FIXED_ALIGN)); }
+  double *row_ptr(size_t i) { return static_cast<double*>(__builtin_assume_aligned(storage_ + i * stride, FIXED_ALIGN)); }
+
+  void hebbian(const packed_patterns_t &patterns, const double keep, const double scale);
+
+  size_t num_patterns_;
+  double *storage_;  // N rows of stride doubles
+};
+
+// is there a FixedMatrix for N neurons
+bool has_fixed_kernel(const size_t N);
+
+// call fn with a zeroed network of N neurons, the FixedMatrix<N> when N is one of
+// FIXED_SIZES and the dynamic hopfield_t otherwise (fn is generic over the network type)
+template<typename Fn>
+void with_fixed_hopfield(const size_t N, Fn fn) {
+  #define FIXED_CASE(n) case n: { FixedMatrix<n> hopfield; fn(hopfield); return; }
+  switch (N) {
+    FIXED_SIZES(FIXED_CASE)
+    default: break;
+  }
+  #undef FIXED_CASE
+
+  hopfield_t hopfield(N);
+  fn(hopfield);
+}
+
+#endif
@@ -1,173 +1,879 @@
 #include "matrix.hpp"
+#include "sparse.hpp"
+#include "symmetric.hpp"
+#include "quantized.hpp"
+#include "fixed.hpp"
+#include "store.hpp"
 #include "vector.hpp"
+#include "packed.hpp"
+#include "scheduler.hpp"
+#include "proportion.hpp"
+#include "instrument.hpp"
+#include "sink.hpp"
+#include "journal.hpp"
+#include "config.hpp"
 #include <iostream>
 #include <fstream>
 #include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
 #include <cmath>
 #include <omp.h>
+#include <atomic>
+#include <memory>
+#include <chrono>
+
+// journal of the finished simulations that an interrupted sweep resumes from (--resume),
+// synced to disk together with the rows written so far every checkpoint_seconds
+// (the grid, sampling and network settings of a sweep are read at startup, see config.hpp)
+#define PROPORTION_CHECKPOINT "proportion-checkpoint.bin"
+
+// files of a network trained once (--save-network base) and probed by later runs (network = base)
+#define STORED_WEIGHTS "-weights.bin"
+#define STORED_PATTERNS "-patterns.bin"
+
+// every network type is compiled into every mode of the sweep and one is picked per network size at startup
+template<typename H>
+struct NetworkTag {
+  typedef H type;
+};
+
+// call fn with the tag of the network type for num_neurons: the weights of the config, for dense weights of
+// the sizes in FIXED_SIZES (fixed.hpp) FixedMatrix<N> with kernels compiled for exactly that many neurons
+// unless fixed_kernels is off, the dynamic Matrix for any other size (fn is generic over the tag)
+template<typename Fn>
+void dispatch_network(const SweepConfig &config, const size_t num_neurons, Fn fn) {
+  switch (config.weights) {
+    case WEIGHTS_SYMMETRIC: fn(NetworkTag<sym_hopfield_t>()); return;
+    case WEIGHTS_QUANTIZED: fn(NetworkTag<quant_hopfield_t>()); return;
+    case WEIGHTS_SPARSE: fn(NetworkTag<sparse_hopfield_t>()); return;
+    case WEIGHTS_DENSE: break;
+  }
 
-// general flag to see progress of network specifically
-// #define DEBUG
+  if (config.fixed_kernels) {
+    #define FIXED_CASE(n) case n: fn(NetworkTag<FixedMatrix<n>>()); return;
+    switch (num_neurons) {
+      FIXED_SIZES(FIXED_CASE)
+      default: break;
+    }
+    #undef FIXED_CASE
+  }
+  fn(NetworkTag<hopfield_t>());
+}
 
-// how many neurons to use for proportion convergence simulation
-#define PROPORTION_NEURONS_MIN 50
-#define PROPORTION_NEURONS_MAX 450
-#define PROPORTION_NEURONS_STEP 100
+// call fn with a zeroed network of num_neurons of the type picked for it (fn is generic over the network type)
+template<typename Fn>
+void with_network(const SweepConfig &config, const size_t num_neurons, Fn fn) {
+  dispatch_network(config, num_neurons, [&](auto tag) {
+    typename decltype(tag)::type hopfield(num_neurons);
+    fn(hopfield);
+  });
+}
 
-// how many patterns to train on (starts with 0 extra as in only the original pattern)
-#define PROPORTION_TRAIN_PATTERNS_MAX static_cast<size_t>(std::ceil(static_cast<double>(num_neurons) / (2.0 * std::log(static_cast<double>(num_neurons))))) // absolute max for Hebb which is N / sqrt(2 * ln(N))
-#define PROPORTION_TRAIN_PATTERNS_STEP static_cast<size_t>(std::max(1.0, PROPORTION_TRAIN_PATTERNS_MAX / 20.0)) // how many patterns to increment by
+// which weights and kernels a network type recalls with (probes are always packed states)
+std::string network_variant(NetworkTag<hopfield_t>) {
+  return std::string("Matrix<double> weights, packed states, ") + bipolar_variant() + " bipolar fields";
+}
 
-// hamming from original pattern (starts at 1) of the test patterns to test convergence on 
-#define PROPORTION_RUN_PATTERN_HAMMING_MAX num_neurons * 0.5 // how far away to generate the maximum hamming patternt to test convergence (this value is proportion of number of neurons)
-#define PROPORTION_RUN_PATTERN_HAMMING_STEP static_cast<size_t>(std::max(1.0, PROPORTION_RUN_PATTERN_HAMMING_MAX / 100.0)) // how much to increase hamming each time
+template<size_t N>
+std::string network_variant(NetworkTag<FixedMatrix<N>>) {
+  return "FixedMatrix<" + std::to_string(N) + "> weights (kernels compiled for " + std::to_string(N) + " neurons), packed states, " + bipolar_variant() + " bipolar fields";
+}
 
-// how many patterns and simulations to test on
-#define PROPORTION_RUN_PATTERNS 100 // how many patterns to test the proportion on
-#define PROPORTION_SIMULATION_PER_STEP 200  // run XX simulations for each step
+std::string network_variant(NetworkTag<sym_hopfield_t>) {
+  return "SymMatrix<double> upper triangle tiles, packed states";
+}
 
+std::string network_variant(NetworkTag<quant_hopfield_t>) {
+  return "QuantMatrix int8/int16/int32 weights (narrowest for the trained patterns), packed states, integer fields";
+}
 
-int proportion_of_convergence(hopfield_t &hopfield, const size_t num_patterns, const size_t hamming, const bool train_hammed, const size_t train_hamming, const size_t num_train_patterns) {
-  // runs a simulation calculating the proportion of valus converging in parallel
+std::string network_variant(NetworkTag<sparse_hopfield_t>) {
+  return "SparseMatrix<double> CSR weights, packed states";
+}
 
-  // create the original pattern
-  #ifdef DEBUG
-    std::cout << "Creating random pattern" << std::endl;
-  #endif
-  const size_t neuron_size = hopfield.num_rows();
-  pattern_t pattern(neuron_size);
-  pattern.randomize(); // give 1/2 prob to each 1,-1
-
-  // container for all patterns (original pattern will be included in this)
-  {
-    patterns_t train_patterns;
-
-    // add original pattern to training
-    train_patterns.push_back(pattern);
-
-    // now create the mostly orthoginal (until a certain point) patterns that are all a certain hamming away
-    if (train_hammed) { // let's specify the hamming distance for our training patterns? would be interesting to see radius of convergence as ham distance changes
-      #ifdef DEBUG
-        std::cout << "Creating training patterns " << num_train_patterns << " patterns with radius " << train_hamming << " from original" << std::endl;
-      #endif
-      make_hammed_patterns(pattern, train_patterns, num_train_patterns, train_hamming, false); // last flag means increment hamming which we want to be false
-    } else {
-      #ifdef DEBUG
-        std::cout << "Creating random training patterns " << num_train_patterns << std::endl;
-      #endif
-      // add random patterns to training
-      make_random_patterns(neuron_size, train_patterns, num_train_patterns);
+// print the variant every network size of the run is dispatched to
+void print_network_variants(const SweepConfig &config) {
+  for (size_t num_neurons : config.neurons) {
+    dispatch_network(config, num_neurons, [&](auto tag) {
+      std::cout << "---- " << num_neurons << " neurons: " << network_variant(tag) << " ----" << std::endl;
+    });
+  }
+}
+
+// draw the connectivity of a diluted network (fully connected ones have none to draw, a ring lattice is the same every time)
+template<typename H>
+void dilute_network(H &, const SweepConfig &, Rng &) {}
+
+void dilute_network(sparse_hopfield_t &hopfield, const SweepConfig &config, Rng &rng) {
+  if (config.connectivity == CONNECT_NEAREST) {
+    hopfield.nearest(config.neighbours);
+  } else {
+    hopfield.dilute(config.dilution, rng);
+  }
+}
+
+// a network trained once: its weights are mapped from base-weights.bin and used in place (read-only, so every
+// thread and process probing it shares one copy), base-patterns.bin holds the patterns it was trained on
+struct StoredNetwork {
+  hopfield_view_t   weights;
+  packed_patterns_t patterns;
+
+  StoredNetwork(const std::string &base) : weights(base + STORED_WEIGHTS), patterns(PatternsView(base + STORED_PATTERNS).patterns()) {
+    if (patterns.empty() || patterns[0].num_rows() != weights.num_rows() || weights.num_rows() < 2) {
+      std::cerr << base << STORED_PATTERNS << " does not hold the patterns of the " << weights.num_rows() << " neuron network in " << base << STORED_WEIGHTS << std::endl;
+      std::exit(1);
     }
+  }
 
-    // train a network on the specified patterns
-    #ifdef DEBUG
-      std::cout << "Training network" << std::endl;
-    #endif
+  // every simulation probes one of the trained patterns in turn (trained_patterns of the rows counts the others)
+  const packed_pattern_t &pattern(const size_t simulation) const { return patterns[simulation % patterns.size()]; }
+  size_t train_patterns() const { return patterns.size() - 1; }
+};
+
+// train the one network size of the config on an original plus train_patterns_max random patterns (the Hebbian
+// capacity when 0) drawn from the master seed and write it as base-weights.bin and base-patterns.bin
+void save_network(const SweepConfig &config, const std::string &base) {
+  if (config.neurons.size() != 1) {
+    std::cerr << "--save-network trains one network, give a single size (--neurons N)" << std::endl;
+    std::exit(1);
+  }
+  const size_t num_neurons = config.neurons[0];
+  Rng rng = Rng(master_seed()).split(num_neurons);
+  packed_patterns_t patterns;
+  make_random_patterns(num_neurons, patterns, config.max_train_patterns(num_neurons) + 1, rng);
+
+  hopfield_t hopfield(num_neurons);
+  hopfield.train_on(patterns);
+  save_weights(base + STORED_WEIGHTS, hopfield);
+  save_patterns(base + STORED_PATTERNS, patterns);
+  std::cout << "Saved a network of " << num_neurons << " neurons trained on " << patterns.size() << " patterns to "
+            << base << STORED_WEIGHTS << " and " << base << STORED_PATTERNS << std::endl;
+}
 
-    // train the hopfield network
-    hopfield.zeroize();  // zeroize weights to prevent additional adding
-    hopfield.train_on(train_patterns);
-  } // on exit scope train patterns should be deleted to free memory
+// trained patterns axis of the grid for a network size (a stored network was trained on exactly one set)
+std::vector<size_t> train_patterns_axis(const SweepConfig &config, const size_t num_neurons, const StoredNetwork *stored) {
+  std::vector<size_t> axis;
+  if (stored) {
+    axis.push_back(stored->train_patterns());
+    return axis;
+  }
+  size_t max_train_patterns = config.max_train_patterns(num_neurons);
+  size_t step_train_patterns = config.train_patterns_step(num_neurons);
+  for (size_t train_patterns = 0; train_patterns < max_train_patterns; train_patterns += step_train_patterns) {
+    axis.push_back(train_patterns);
+  }
+  return axis;
+}
 
-  #ifdef DEBUG
-    std::cout << "Creating " << num_patterns << " hammed patterns from original with radius " << hamming << std::endl;
-  #endif
-  patterns_t patterns;
-  make_hammed_patterns(pattern, patterns, num_patterns, hamming, false); // make it not incremementla
+// every simulation draws from its own stream keyed by the grid point and simulation
+// index, so a run is reproducible from the master seed for any number of threads
+// (the grown sweep keys its streams with train_patterns = 0 as one stream covers every step,
+// the shared sweep trains from hamming = 0 and probes every distance from substream 1 of its point)
+Rng simulation_rng(const size_t num_neurons, const size_t train_patterns, const size_t hamming, const size_t simulation) {
+  return Rng(master_seed()).split(num_neurons).split(train_patterns).split(hamming).split(simulation);
+}
+
+// full width of the confidence interval of the mean of the first sims values (normal approximation)
+double confidence_width(const std::vector<double> &vals, const size_t sims) {
+  if (sims < 2) return INFINITY;
+
+  double mean = 0.0;
+  for (size_t j = 0; j < sims; j++) {
+    mean += vals[j];
+  }
+  mean /= static_cast<double>(sims);
+
+  double sum = 0.0;
+  for (size_t j = 0; j < sims; j++) {
+    sum += (vals[j] - mean)*(vals[j] - mean);
+  }
+  double std = std::sqrt(sum / static_cast<double>(sims - 1));
+  return 2.0 * 1.96 * std / std::sqrt(static_cast<double>(sims));  // 95% two sided
+}
+
+// one (neurons, trained patterns, hamming) point of the sweep grid
+struct GridPoint {
+  size_t neurons, train_patterns, hamming;
+  std::vector<double> vals;       // proportion of every simulation (filled by the tasks)
+  std::vector<bool> restored;     // simulations read back from the checkpoint (read-only while running)
+  size_t scheduled;               // simulations queued so far (all of them unless sampling adaptively)
+  std::atomic<size_t> remaining;  // queued simulations not yet finished
+  InstrumentTally tally;          // hot path counters of all its simulations (empty unless built with INSTRUMENT)
+};
+
+// original pattern of one shared simulation and its network (read-only once trained), the network
+// type is picked at runtime so the probes reach it through count_converged
+struct SharedNetwork {
+  packed_pattern_t pattern;
+  size_t           sim;
 
-  // keep track of proportions
-  int converged = 0.0;
-  for (pattern_t &ref_pattern : patterns) {
-    pattern_t retrieved_memory(neuron_size);
+  SharedNetwork(const size_t num_neurons, const size_t simulation) : pattern(num_neurons), sim(simulation) {}
+  virtual ~SharedNetwork() {}
 
-    // run until we reach an energy minimum
-    hopfield.run_to_min(ref_pattern, retrieved_memory);
+  virtual int count_converged(const size_t num_patterns, const size_t hamming, Rng &rng) const = 0;
+};
 
-    // is the retrieved memory from the hopfield network similar to our hammed distance one?
-    if (retrieved_memory.similar(pattern)) {
-        converged++; // add one to converged
+template<typename H>
+struct SharedNetworkOf : SharedNetwork {
+  H hopfield;
+
+  SharedNetworkOf(const size_t num_neurons, const size_t simulation) : SharedNetwork(num_neurons, simulation), hopfield(num_neurons) {}
+
+  int count_converged(const size_t num_patterns, const size_t hamming, Rng &rng) const override {
+    return ::count_converged(hopfield, pattern, num_patterns, hamming, rng);
+  }
+};
+
+// a batch of simulations scheduled as one task, it covers num_points grid points stride apart
+// (more than one when a grown network walks the trained patterns axis, whose points are a row of
+// hamming distances apart, or a shared network is trained for every hamming distance)
+struct SweepTask {
+  size_t point, num_points;
+  size_t first_sim, num_sims;
+  std::shared_ptr<const SharedNetwork> network;  // set for the probes of one shared network
+  size_t stride = 1;
+
+  size_t point_at(const size_t s) const { return point + s * stride; }
+};
+
+// simulations of one grid point, each retraining a fresh network (or probing the stored one)
+void run_point_simulations(const SweepConfig &config, const StoredNetwork *stored, GridPoint &point, const size_t first_sim, const size_t num_sims) {
+  InstrumentSnapshot snapshot;
+  if (stored) {
+    for (size_t j = first_sim; j < first_sim + num_sims; j++) {
+      Rng rng = simulation_rng(point.neurons, point.train_patterns, point.hamming, j);
+      point.vals[j] = count_converged(stored->weights, stored->pattern(j), config.test_patterns, point.hamming, rng);
     }
+    point.tally.add_since(snapshot);
+    return;
   }
 
-  // return the proportion that have converged
-  return converged;
+  with_network(config, point.neurons, [&](auto &hopfield) {
+    for (size_t j = first_sim; j < first_sim + num_sims; j++) {
+      Rng rng = simulation_rng(point.neurons, point.train_patterns, point.hamming, j);
+      dilute_network(hopfield, config, rng);
+      point.vals[j] = proportion_of_convergence<packed_pattern_t>(hopfield, config.test_patterns, point.hamming, false, 0, point.train_patterns, rng);
+    }
+  });
+  point.tally.add_since(snapshot);
 }
 
-void run_proportion_simulations() {
-  // run various monte carlo simulations to determine behaviour of various convergence (number of patterns)
+// counters of a finished grid point as a row of the trace file
+void write_trace_row(std::ofstream &trace, const GridPoint &point) {
+  trace << point.neurons << "," << point.train_patterns << "," << point.hamming;
+  for (size_t c = 0; c < INSTR_NUM_COUNTERS; c++) {
+    trace << "," << point.tally(c);
+  }
+  trace << "\n";
+}
 
-  // create the csv file
-  std::ofstream data("proportion-data.csv");
-  data << "neurons,trained_patterns,test_patterns,test_pattern_hamming,simulations_per_step,min_proportion,mean_proportion,max_proportion,std_proportion,25_perc,mode,75_perc" << std::endl;
+// every simulation owns one network and original pattern that grows across the
+// trained patterns axis (points in ascending train_patterns), so each step only learns the newly added patterns
+template<typename H>
+void grow_simulations(H &hopfield, const size_t test_patterns, GridPoint *points, const size_t num_points, const size_t stride, const size_t first_sim, const size_t num_sims) {
+  const size_t num_neurons = points[0].neurons;
+  const size_t hamming = points[0].hamming;
+  for (size_t j = first_sim; j < first_sim + num_sims; j++) {
+    InstrumentSnapshot snapshot;  // the initial training is attributed to the first step
+    Rng rng = simulation_rng(num_neurons, 0, hamming, j);
+    packed_pattern_t pattern(num_neurons);
+
+    // start from a network that only knows the original pattern
+    {
+      INSTR_SCOPE(INSTR_TRAIN_NS);
+      pattern.randomize(rng);
+      hopfield.zeroize();
+      hopfield.add_pattern(pattern);
+    }
 
-  for (size_t num_neurons = PROPORTION_NEURONS_MIN; num_neurons < PROPORTION_NEURONS_MAX; num_neurons += PROPORTION_NEURONS_STEP) {
-    // calculate maximum number of training patterns
-    size_t max_train_patterns = PROPORTION_TRAIN_PATTERNS_MAX;
-    size_t step_train_patterns = PROPORTION_TRAIN_PATTERNS_STEP;
+    size_t trained = 0;
+    for (size_t s = 0; s < num_points; s++) {
+      GridPoint &point = points[s * stride];
+
+      // learn the patterns added since the last step
+      {
+        INSTR_SCOPE(INSTR_TRAIN_NS);
+        Scratch<packed_pattern_t, SCRATCH_TRAIN> new_lease;
+        packed_patterns_t &new_patterns = *new_lease;
+        fill_random_patterns(num_neurons, new_patterns, 0, point.train_patterns - trained, rng);
+        hopfield.add_patterns(new_patterns);
+        trained = point.train_patterns;
+      }
+
+      point.vals[j] = count_converged(hopfield, pattern, test_patterns, hamming, rng);
+      point.tally.add_since(snapshot);
+      snapshot = InstrumentSnapshot();
+    }
+  }
+}
 
-    for (size_t train_patterns = 0; train_patterns < max_train_patterns; train_patterns += step_train_patterns) {
-      std::cout << "---- Running simulations on " << num_neurons << " neurons and " << train_patterns << " trained patterns ----" << std::endl;
+// diluted networks only train whole (check_sweep_config refuses grown sparse sweeps)
+void grow_simulations(sparse_hopfield_t &, const size_t, GridPoint *, const size_t, const size_t, const size_t, const size_t) {
+  std::cerr << "Grown networks are only supported for fully connected networks" << std::endl;
+  std::exit(1);
+}
+
+void run_grown_simulations(const SweepConfig &config, GridPoint *points, const size_t num_points, const size_t stride, const size_t first_sim, const size_t num_sims) {
+  with_network(config, points[0].neurons, [&](auto &hopfield) {
+    grow_simulations(hopfield, config.test_patterns, points, num_points, stride, first_sim, num_sims);
+  });
+}
+
+// train the networks of a shared task (the hamming distances of one (neurons, trained patterns) pair)
+// and queue one probing task per (network, hamming distance) that the other threads can steal
+void train_shared_networks(const SweepConfig &config, Scheduler<SweepTask> &scheduler, GridPoint *points, const SweepTask &task) {
+  const size_t num_neurons = points[0].neurons;
+  const size_t train_patterns = points[0].train_patterns;
+
+  for (size_t j = task.first_sim; j < task.first_sim + task.num_sims; j++) {
+    // a resumed sweep only probes the distances the checkpoint lacks
+    bool needed = false;
+    for (size_t s = 0; s < task.num_points; s++) {
+      needed = needed || !points[s].restored[j];
+    }
+    if (!needed) continue;
+
+    InstrumentSnapshot snapshot;  // training is attributed to the first distance
+    std::shared_ptr<SharedNetwork> shared;
+    dispatch_network(config, num_neurons, [&](auto tag) {
+      typedef SharedNetworkOf<typename decltype(tag)::type> shared_t;
+      std::shared_ptr<shared_t> network = std::make_shared<shared_t>(num_neurons, j);
+      Rng rng = simulation_rng(num_neurons, train_patterns, 0, j);
+      dilute_network(network->hopfield, config, rng);
+      train_network(network->hopfield, network->pattern, false, 0, train_patterns, rng);
+      shared = network;
+    });
+    points[0].tally.add_since(snapshot);
+
+    for (size_t s = 0; s < task.num_points; s++) {
+      if (!points[s].restored[j]) scheduler.push({task.point + s, 1, j, 1, shared});
+    }
+  }
+}
 
-      // calculate the maximum hamming
-      size_t max_hamming = static_cast<size_t>(PROPORTION_RUN_PATTERN_HAMMING_MAX) + 1;
-      size_t step_hamming = PROPORTION_RUN_PATTERN_HAMMING_STEP;
+// probe a shared network at the distance of its grid point
+void run_shared_simulation(const SweepConfig &config, GridPoint &point, const SharedNetwork &shared) {
+  InstrumentSnapshot snapshot;
+  Rng rng = simulation_rng(point.neurons, point.train_patterns, point.hamming, shared.sim).split(1);
+  point.vals[shared.sim] = shared.count_converged(config.test_patterns, point.hamming, rng);
+  point.tally.add_since(snapshot);
+}
 
-      #pragma omp parallel for // multithread the task
+// flatten the whole (neurons, trained patterns, hamming, simulation batch) grid into tasks
+// (the grid, and so the rows, are in the same order in every mode: grown sweeps group the trained patterns
+// of one (neurons, hamming) pair, a row of hamming distances apart, shared sweeps group the hamming distances
+// of one (neurons, trained patterns) pair), only the first initial_sims simulations of every point are queued
+size_t build_sweep_grid(const SweepConfig &config, const StoredNetwork *stored, std::vector<GridPoint> &grid, std::vector<SweepTask> &tasks, const size_t initial_sims) {
+  const SweepMode mode = config.mode;
+  struct Key { size_t neurons, train_patterns, hamming; };
+  std::vector<Key> keys;
+  struct Group { size_t first, num_points, stride; };
+  std::vector<Group> groups;  // points simulated together
+
+  for (size_t num_neurons : config.neurons) {
+    // the trained patterns of every network of this size
+    const std::vector<size_t> train_axis = train_patterns_axis(config, num_neurons, stored);
+
+    // calculate the maximum hamming
+    size_t max_hamming = config.max_hamming(num_neurons) + 1;
+    size_t step_hamming = config.hamming_step(num_neurons);
+
+    const size_t first_of_size = keys.size();
+    for (size_t train_patterns : train_axis) {
+      size_t first = keys.size();
       for (size_t hamming = 0; hamming < max_hamming; hamming += step_hamming) {
-        // reuse network to reduce copying/zeroing
-        hopfield_t hopfield(num_neurons, num_neurons);
-
-        // get basic stats
-        int min = INT32_MAX;
-        int max = -INT32_MAX;
-        double mean = 0.0;
-        double vals[PROPORTION_SIMULATION_PER_STEP];
-        for (size_t j = 0; j < PROPORTION_SIMULATION_PER_STEP; j++) {
-          int prop = proportion_of_convergence(hopfield, PROPORTION_RUN_PATTERNS, hamming, false, 0, train_patterns);
-          if (prop < min) {
-            min = prop;
-          }
-          if (prop > max) {
-            max = prop;
-          }
-          mean += static_cast<double>(prop);
-          vals[j] = prop;
+        if (mode == SWEEP_FRESH) {
+          groups.push_back({keys.size(), 1, 1});
         }
+        keys.push_back({num_neurons, train_patterns, hamming});
+      }
+      if (mode == SWEEP_SHARED) {
+        groups.push_back({first, keys.size() - first, 1});
+      }
+    }
 
-        // get stats
-        mean /= static_cast<double>(PROPORTION_SIMULATION_PER_STEP);
-        
-        // calculate standard deviation
-        double sum = 0.0;
-        for (size_t j = 0; j < PROPORTION_SIMULATION_PER_STEP; j++) {
-          sum += (vals[j] - mean)*(vals[j] - mean);
-        }
-        double std = std::sqrt(sum / static_cast<double>(PROPORTION_SIMULATION_PER_STEP - 1));
-
-        // get percentiles
-        std::sort(vals, vals + PROPORTION_SIMULATION_PER_STEP);
-        double twentyfive = vals[static_cast<size_t>(0.25 * PROPORTION_SIMULATION_PER_STEP)];
-        double mode = vals[static_cast<size_t>(0.50 * PROPORTION_SIMULATION_PER_STEP)];
-        double seventyfive = vals[static_cast<size_t>(0.75 * PROPORTION_SIMULATION_PER_STEP)];
-
-        #pragma omp critical
-        {
-          // save results to CSV file
-          data << num_neurons << "," << train_patterns << "," << PROPORTION_RUN_PATTERNS << "," << hamming << "," << PROPORTION_SIMULATION_PER_STEP << "," << min 
-              << "," << mean << "," << max << "," << std << "," << twentyfive << "," << mode << "," << seventyfive << std::endl;
-        }
+    if (mode == SWEEP_GROWN) {
+      const size_t num_hamming = (max_hamming + step_hamming - 1) / step_hamming;
+      const size_t num_train = (keys.size() - first_of_size) / num_hamming;
+      for (size_t h = 0; h < num_hamming; h++) {
+        groups.push_back({first_of_size + h, num_train, num_hamming});
       }
     }
   }
 
-  // close the file
-  data.close();
+  grid = std::vector<GridPoint>(keys.size());
+  for (size_t p = 0; p < keys.size(); p++) {
+    grid[p].neurons = keys[p].neurons;
+    grid[p].train_patterns = keys[p].train_patterns;
+    grid[p].hamming = keys[p].hamming;
+    grid[p].vals.assign(config.simulations, 0.0);
+    grid[p].restored.assign(config.simulations, false);
+    grid[p].scheduled = initial_sims;
+    grid[p].remaining = initial_sims;
+  }
+
+  for (const Group &group : groups) {
+    for (size_t j = 0; j < initial_sims; j += config.batch) {
+      tasks.push_back({group.first, group.num_points, j, std::min(config.batch, initial_sims - j), nullptr, group.stride});
+    }
+  }
+  return grid.size();
+}
+
+// keep the tasks of one shard of the sweep, the shard-th of every num_shards tasks in grid order, so every
+// shard simulates a share of every point (and so of every network size), owned marks the points it touches
+void select_shard(std::vector<SweepTask> &tasks, std::vector<bool> &owned, const size_t shard, const size_t num_shards) {
+  std::vector<SweepTask> kept;
+  for (size_t t = shard; t < tasks.size(); t += num_shards) {
+    kept.push_back(tasks[t]);
+    for (size_t s = 0; s < tasks[t].num_points; s++) {
+      owned[tasks[t].point_at(s)] = true;
+    }
+  }
+  tasks.swap(kept);
+}
+
+// journal of a run, each shard has its own
+std::string checkpoint_path(const size_t shard, const size_t num_shards) {
+  if (num_shards == 1) return PROPORTION_CHECKPOINT;
+  return "proportion-shard-" + std::to_string(shard) + "-of-" + std::to_string(num_shards) + ".bin";
+}
+
+// drop the tasks whose simulations were all restored from the checkpoint and recount how many simulations
+// every point still waits for (a shared task trains and probes only the simulations some of its points lack,
+// the other modes rerun a batch whole as its simulations are not separable)
+void prune_restored_tasks(const SweepConfig &config, std::vector<GridPoint> &grid, std::vector<SweepTask> &tasks, const size_t initial_sims) {
+  const SweepMode mode = config.mode;
+  // adaptive batches queued beyond the initial ones before the interruption are queued again
+  for (size_t p = 0; p < grid.size(); p++) {
+    size_t end = initial_sims;
+    for (size_t j = initial_sims; j < grid[p].restored.size(); j++) {
+      if (grid[p].restored[j]) end = j + 1;
+    }
+    for (size_t first = initial_sims; first < end; first += config.batch) {
+      const size_t batch = std::min(config.batch, grid[p].restored.size() - first);
+      tasks.push_back({p, 1, first, batch, nullptr});
+      grid[p].scheduled = first + batch;
+    }
+  }
+
+  for (GridPoint &point : grid) {
+    point.remaining = 0;
+  }
+
+  std::vector<SweepTask> kept;
+  for (const SweepTask &task : tasks) {
+    bool missing = false;
+    for (size_t s = 0; s < task.num_points; s++) {
+      const size_t p = task.point_at(s);
+      for (size_t j = task.first_sim; j < task.first_sim + task.num_sims; j++) {
+        if (grid[p].restored[j]) continue;
+        missing = true;
+        if (mode == SWEEP_SHARED) grid[p].remaining++;
+      }
+    }
+    if (!missing) continue;
+
+    if (mode != SWEEP_SHARED) {
+      for (size_t s = 0; s < task.num_points; s++) {
+        grid[task.point_at(s)].remaining += task.num_sims;
+      }
+    }
+    kept.push_back(task);
+  }
+  tasks.swap(kept);
+}
+
+void run_proportion_simulations(const SweepConfig &config, const StoredNetwork *stored, const bool resume, const int format, const size_t shard, const size_t num_shards) {
+  // run various monte carlo simulations to determine behaviour of various convergence (number of patterns)
+
+  // hot path counters and phase times of every grid point
+  #ifdef INSTRUMENT
+    std::ofstream trace("proportion-trace.csv");
+    trace << "neurons,trained_patterns,test_pattern_hamming";
+    for (size_t c = 0; c < INSTR_NUM_COUNTERS; c++) {
+      trace << "," << instrument_name(c);
+    }
+    trace << std::endl;
+  #endif
+
+  const SweepMode mode = config.mode;
+  const bool adaptive = config.ci_width > 0.0;
+  const size_t initial_sims = adaptive ? std::min(config.simulations_min, config.simulations) : config.simulations;
+
+  std::vector<GridPoint> grid;
+  std::vector<SweepTask> tasks;
+  build_sweep_grid(config, stored, grid, tasks, initial_sims);
+
+  // a shard only runs its share of the tasks and leaves the summaries to the merge of all shards
+  // (the streams are keyed by grid point and simulation, so the merged shards equal an unsharded run)
+  const bool sharded = num_shards > 1;
+  std::vector<bool> owned(grid.size(), !sharded);
+  if (sharded) {
+    if (adaptive) {
+      std::cerr << "Adaptive sampling needs every simulation of a grid point in one process and can not be sharded" << std::endl;
+      std::exit(1);
+    }
+    select_shard(tasks, owned, shard, num_shards);
+  }
+  const size_t num_owned = static_cast<size_t>(std::count(owned.begin(), owned.end(), true));
+
+  // every finished batch is journaled, a resumed run reads back what is done and only queues the rest
+  std::vector<JournalPoint> points;
+  for (const GridPoint &point : grid) {
+    points.push_back({static_cast<uint32_t>(point.neurons), static_cast<uint32_t>(point.train_patterns), static_cast<uint32_t>(point.hamming)});
+  }
+  const std::string journal_path = checkpoint_path(shard, num_shards);
+  size_t restored = 0;
+  SweepJournal journal(journal_path, journal_header(master_seed(), mode, config.test_patterns, config.simulations, result_settings(config), shard, num_shards, points), points, resume,
+      [&](size_t p, size_t first_sim, const uint16_t *values, size_t num_sims) {
+    for (size_t j = 0; j < num_sims; j++) {
+      grid[p].vals[first_sim + j] = static_cast<double>(values[j]);
+      grid[p].restored[first_sim + j] = true;
+    }
+    restored += num_sims;
+  });
+  if (restored > 0) {
+    std::cout << "---- Restored " << restored << " simulations from " << journal_path << " ----" << std::endl;
+  }
+  if (restored > 0 || sharded) {
+    prune_restored_tasks(config, grid, tasks, initial_sims);
+  }
+
+  // rows are written in grid order whatever order the points finish in
+  std::unique_ptr<ResultSink<ProportionRecord>> sink;
+  if (!sharded) {
+    sink.reset(new ResultSink<ProportionRecord>("proportion-data", format, grid.size()));
+  }
+
+  // queue in grid order, owners run their newest (largest network) tasks first and thieves take the oldest
+  Scheduler<SweepTask> scheduler;
+  for (const SweepTask &task : tasks) {
+    scheduler.push(task);
+  }
+  if (sharded) {
+    std::cout << "---- Shard " << shard << " of " << num_shards << " (into " << journal_path << ") ----" << std::endl;
+  }
+  std::cout << "---- Running " << num_owned << " grid points as " << tasks.size() << " tasks on " << scheduler.num_threads() << " threads ----" << std::endl;
+
+  std::atomic<size_t> finished(0);
+  const size_t report_every = std::max(static_cast<size_t>(1), num_owned / 100);
+
+  // reduce a grid point once every queued simulation of it is in (the same values for any thread count)
+  auto finish_point = [&](const size_t p) {
+    // queue another batch while the mean is not yet known well enough
+    if (adaptive && grid[p].scheduled < config.simulations && confidence_width(grid[p].vals, grid[p].scheduled) > config.ci_width) {
+      const size_t first = grid[p].scheduled;
+      const size_t batch = std::min(config.batch, config.simulations - first);
+      grid[p].scheduled += batch;
+      grid[p].remaining = batch;
+      scheduler.push({p, 1, first, batch, nullptr});
+      return;
+    }
+    if (sink) {
+      grid[p].vals.resize(grid[p].scheduled);
+      sink->put(p, summarize_proportion(grid[p].neurons, grid[p].train_patterns, config.test_patterns, grid[p].hamming, grid[p].vals));
+    }
+    #ifdef INSTRUMENT
+      #pragma omp critical(trace)
+      write_trace_row(trace, grid[p]);
+    #endif
+
+    size_t done = ++finished;
+    if (done % report_every == 0 || done == num_owned) {
+      #pragma omp critical(progress)
+      std::cout << "---- Finished " << done << " / " << num_owned << " grid points ----" << std::endl;
+    }
+  };
+
+  // points restored whole are reduced right away
+  for (size_t p = 0; p < grid.size(); p++) {
+    if (owned[p] && grid[p].remaining == 0) finish_point(p);
+  }
+
+  // the journal and the rows written so far are synced to disk every checkpoint_seconds
+  const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  std::atomic<long> last_checkpoint(0);
+
+  scheduler.run([&](const SweepTask &task) {
+    if (mode == SWEEP_SHARED && !task.network) {
+      train_shared_networks(config, scheduler, &grid[task.point], task);
+      return;  // its points are reduced by the probing tasks
+    }
+
+    if (mode == SWEEP_GROWN) {
+      run_grown_simulations(config, &grid[task.point], task.num_points, task.stride, task.first_sim, task.num_sims);
+    } else if (mode == SWEEP_SHARED) {
+      run_shared_simulation(config, grid[task.point], *task.network);
+    } else {
+      run_point_simulations(config, stored, grid[task.point], task.first_sim, task.num_sims);
+    }
+
+    for (size_t s = 0; s < task.num_points; s++) {
+      const size_t p = task.point_at(s);
+      journal.record(p, task.first_sim, &grid[p].vals[task.first_sim], task.num_sims);
+    }
+    for (size_t s = 0; s < task.num_points; s++) {
+      const size_t p = task.point_at(s);
+      if (grid[p].remaining.fetch_sub(task.num_sims) == task.num_sims) finish_point(p);
+    }
+
+    long now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started).count();
+    long last = last_checkpoint.load();
+    if (now - last >= static_cast<long>(config.checkpoint_seconds) && last_checkpoint.compare_exchange_strong(last, now)) {
+      journal.checkpoint();
+      if (sink) sink->checkpoint();
+    }
+  });
+
+  #ifdef INSTRUMENT
+    std::cout << "---- Instrumentation totals ----" << std::endl;
+    for (size_t c = 0; c < INSTR_NUM_COUNTERS; c++) {
+      std::cout << instrument_name(c) << ": " << instrument_total(c) << std::endl;
+    }
+    trace.close();
+  #endif
+
+  // write out the remaining rows and close the files
+  journal.close();
+  if (sink) sink->close();
+}
+
+// one (neurons, trained patterns) point of the basin radius estimation
+struct RadiusPoint {
+  size_t neurons, train_patterns;
+  std::vector<double> radii;        // critical radius of every simulated network
+  std::vector<size_t> evaluations;  // count_converged calls of every bisection
+  std::atomic<size_t> remaining;    // networks not yet finished
+};
+
+struct RadiusTask {
+  size_t point;
+  size_t first_sim, num_sims;
+};
+
+// train networks of one (neurons, trained patterns) pair and bisect each for its radius (or bisect the basins
+// of the patterns of the stored network)
+void run_radius_simulations(const SweepConfig &config, const StoredNetwork *stored, RadiusPoint &point, const size_t first_sim, const size_t num_sims) {
+  const size_t num_neurons = point.neurons;
+  const size_t max_hamming = config.max_hamming(num_neurons);
+  if (stored) {
+    for (size_t j = first_sim; j < first_sim + num_sims; j++) {
+      Rng rng = simulation_rng(num_neurons, point.train_patterns, 0, j);
+      point.radii[j] = static_cast<double>(basin_radius(stored->weights, stored->pattern(j), config.test_patterns, max_hamming, config.radius_threshold, point.evaluations[j], rng));
+    }
+    return;
+  }
+
+  packed_pattern_t pattern(num_neurons);
+
+  with_network(config, num_neurons, [&](auto &hopfield) {
+    for (size_t j = first_sim; j < first_sim + num_sims; j++) {
+      Rng rng = simulation_rng(num_neurons, point.train_patterns, 0, j);
+      dilute_network(hopfield, config, rng);
+      train_network(hopfield, pattern, false, 0, point.train_patterns, rng);
+      point.radii[j] = static_cast<double>(basin_radius(hopfield, pattern, config.test_patterns, max_hamming, config.radius_threshold, point.evaluations[j], rng));
+    }
+  });
+}
+
+// summarize the radii of one point, the error bar is the standard error of the mean radius
+RadiusRecord summarize_radius(const SweepConfig &config, const RadiusPoint &point) {
+  const size_t sims = point.radii.size();
+
+  double min = point.radii[0];
+  double max = point.radii[0];
+  double mean = 0.0;
+  double evaluations = 0.0;
+  for (size_t j = 0; j < sims; j++) {
+    min = std::min(min, point.radii[j]);
+    max = std::max(max, point.radii[j]);
+    mean += point.radii[j];
+    evaluations += static_cast<double>(point.evaluations[j]);
+  }
+  mean /= static_cast<double>(sims);
+  evaluations /= static_cast<double>(sims);
+
+  double sum = 0.0;
+  for (size_t j = 0; j < sims; j++) {
+    sum += (point.radii[j] - mean)*(point.radii[j] - mean);
+  }
+  double std = sims > 1 ? std::sqrt(sum / static_cast<double>(sims - 1)) : 0.0;
+  double stderr_mean = std / std::sqrt(static_cast<double>(sims));
+
+  return {point.neurons, point.train_patterns, config.test_patterns, config.radius_threshold, sims, min, mean, max, std, stderr_mean, evaluations};
+}
+
+// locate the basin radius of every (neurons, trained patterns) pair by bisection over the hamming distance
+// instead of sweeping every distance (about log2(N / 2) probe rounds per network)
+void run_radius_estimation(const SweepConfig &config, const StoredNetwork *stored, const int format) {
+  std::vector<std::pair<size_t, size_t>> keys;
+  for (size_t num_neurons : config.neurons) {
+    for (size_t train_patterns : train_patterns_axis(config, num_neurons, stored)) {
+      keys.push_back(std::make_pair(num_neurons, train_patterns));
+    }
+  }
+
+  std::vector<RadiusPoint> grid(keys.size());
+  ResultSink<RadiusRecord> sink("basin-radius", format, grid.size());
+  Scheduler<RadiusTask> scheduler;
+  for (size_t p = 0; p < keys.size(); p++) {
+    grid[p].neurons = keys[p].first;
+    grid[p].train_patterns = keys[p].second;
+    grid[p].radii.assign(config.simulations, 0.0);
+    grid[p].evaluations.assign(config.simulations, 0);
+    grid[p].remaining = config.simulations;
+    for (size_t j = 0; j < config.simulations; j += config.batch) {
+      scheduler.push({p, j, std::min(config.batch, config.simulations - j)});
+    }
+  }
+  std::cout << "---- Estimating the basin radius of " << grid.size() << " points on " << scheduler.num_threads() << " threads ----" << std::endl;
+
+  std::atomic<size_t> finished(0);
+  scheduler.run([&](const RadiusTask &task) {
+    RadiusPoint &point = grid[task.point];
+    run_radius_simulations(config, stored, point, task.first_sim, task.num_sims);
+    if (point.remaining.fetch_sub(task.num_sims) != task.num_sims) return;
+
+    sink.put(task.point, summarize_radius(config, point));
+    size_t done = ++finished;
+    #pragma omp critical(progress)
+    std::cout << "---- Finished " << done << " / " << grid.size() << " points ----" << std::endl;
+  });
+
+  sink.close();
 }
 
 
 int main(int argc, char* argv[]) {
-  std::cout << "Running proportion simulations" << std::endl;
-  run_proportion_simulations();
+  // a fresh master seed unless one is given to rerun (--seed N)
+  // (--radius estimates the basin radius instead of sweeping the proportion over every distance,
+  // --resume continues the sweep of PROPORTION_CHECKPOINT with its seed,
+  // --format csv|npy|both picks the result files, see sink.hpp,
+  // --shard i/k runs only the i-th of k parts of the sweep, to be combined by ./merge,
+  // --config path reads the grid, sampling and network settings from a file and --<setting> value overrides
+  // one of them, e.g. --neurons 64,128,1024 --simulations 50 --weights quantized, see config.hpp,
+  // --save-network base only trains one network and writes it for later runs to probe with --network base)
+  uint64_t seed = random_seed();
+  bool seeded = false;
+  bool radius = false;
+  bool resume = false;
+  int format = RESULTS_CSV;
+  size_t shard = 0, num_shards = 1;
+  std::string config_path;
+  std::string save_base;
+  std::vector<std::pair<std::string, std::string>> settings;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seed") == 0 && (i + 1) < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+      seeded = true;
+    } else if (strcmp(argv[i], "--radius") == 0) {
+      radius = true;
+    } else if (strcmp(argv[i], "--resume") == 0) {
+      resume = true;
+    } else if (strcmp(argv[i], "--format") == 0 && (i + 1) < argc) {
+      i++;
+      if (strcmp(argv[i], "csv") == 0) {
+        format = RESULTS_CSV;
+      } else if (strcmp(argv[i], "npy") == 0) {
+        format = RESULTS_NPY;
+      } else if (strcmp(argv[i], "both") == 0) {
+        format = RESULTS_BOTH;
+      } else {
+        std::cerr << "Unknown result format " << argv[i] << " (csv, npy or both)" << std::endl;
+        std::exit(1);
+      }
+    } else if (strcmp(argv[i], "--shard") == 0 && (i + 1) < argc) {
+      i++;
+      if (sscanf(argv[i], "%zu/%zu", &shard, &num_shards) != 2 || num_shards == 0 || shard >= num_shards) {
+        std::cerr << "Expected --shard i/k with 0 <= i < k, got " << argv[i] << std::endl;
+        std::exit(1);
+      }
+    } else if (strcmp(argv[i], "--config") == 0 && (i + 1) < argc) {
+      config_path = argv[++i];
+    } else if (strcmp(argv[i], "--save-network") == 0 && (i + 1) < argc) {
+      save_base = argv[++i];
+    } else if (strncmp(argv[i], "--", 2) == 0 && (i + 1) < argc) {
+      settings.push_back(std::make_pair(std::string(argv[i] + 2), std::string(argv[i + 1])));
+      i++;
+    } else {
+      std::cerr << "Unknown option " << argv[i] << std::endl;
+      std::exit(1);
+    }
+  }
+
+  // the command line overrides the config file whatever their order
+  SweepConfig config;
+  if (!config_path.empty()) {
+    read_sweep_config(config_path, config);
+  }
+  for (const std::pair<std::string, std::string> &setting : settings) {
+    if (!set_sweep_option(config, setting.first, setting.second, "command line")) {
+      std::cerr << "Unknown option --" << setting.first << std::endl;
+      std::exit(1);
+    }
+  }
+  check_sweep_config(config);
+  if (config.bipolar != "auto" && !bipolar_select(config.bipolar.c_str())) {
+    std::cerr << "Bipolar kernel " << config.bipolar << " is not supported on this cpu" << std::endl;
+    std::exit(1);
+  }
+
+  if (num_shards > 1 && radius) {
+    std::cerr << "Only the proportion sweep can be sharded" << std::endl;
+    std::exit(1);
+  }
+
+  // every shard has to draw from the same master seed
+  if (num_shards > 1 && !resume && !seeded) {
+    std::cerr << "Sharded runs need the master seed shared by all shards (--seed N)" << std::endl;
+    std::exit(1);
+  }
+
+  JournalHeader checkpoint;
+  const std::string journal_path = checkpoint_path(shard, num_shards);
+  if (resume && !radius && read_journal_header(journal_path, checkpoint)) {
+    if (seeded && seed != checkpoint.seed) {
+      std::cerr << journal_path << " was written with master seed " << checkpoint.seed << ", not " << seed << std::endl;
+      std::exit(1);
+    }
+    seed = checkpoint.seed;
+    std::cout << "Resuming from " << journal_path << std::endl;
+  } else if (resume && num_shards > 1 && !seeded) {
+    std::cerr << "Nothing to resume in " << journal_path << ", start the shard with --seed N" << std::endl;
+    std::exit(1);
+  }
+  set_master_seed(seed);
+  std::cout << "Using master seed " << seed << std::endl;
+
+  if (!save_base.empty()) {
+    save_network(config, save_base);
+    return 0;
+  }
+
+  // a stored network sets the one network size of the run
+  std::unique_ptr<StoredNetwork> stored;
+  if (!config.network.empty()) {
+    stored.reset(new StoredNetwork(config.network));
+    config.neurons.assign(1, stored->weights.num_rows());
+  }
+
+  std::cout << "Sweeping " << describe_sweep_config(config) << std::endl;
+  if (stored) {
+    std::cout << "---- " << stored->weights.num_rows() << " neurons: stored MatrixView<double> weights of " << config.network
+              << " (trained on " << stored->patterns.size() << " patterns), packed states, " << bipolar_variant() << " bipolar fields ----" << std::endl;
+  } else {
+    print_network_variants(config);
+  }
+
+  if (radius) {
+    std::cout << "Running basin radius estimation" << std::endl;
+    run_radius_estimation(config, stored.get(), format);
+  } else {
+    std::cout << "Running proportion simulations" << std::endl;
+    run_proportion_simulations(config, stored.get(), resume, format, shard, num_shards);
+  }
 
   /*
 
@@ -0,0 +1,149 @@
+#ifndef INSTRUMENT_HPP
+#define INSTRUMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+
+// hot path counters and phase timers, only compiled in when INSTRUMENT is defined
+// (make DEFS=-DINSTRUMENT), otherwise every macro and helper below is empty
+//   INSTR_COUNT(counter, n)  add n to one of this thread's counters
+//   INSTR_SCOPE(counter)     add the nanoseconds until the end of the scope to a timer counter
+// every thread owns a block of counters that only it writes (plain relaxed stores),
+// blocks are linked into a lock-free list once so totals can be summed at any time
+
+enum InstrumentCounter {
+  INSTR_SWEEPS,       // asynchronous/synchronous sweeps over all neurons (per probe)
+  INSTR_FLIPS,        // neuron state flips during recall
+  INSTR_MATVECS,      // full local field / matrix-vector evaluations (per probe)
+  INSTR_ENERGY_EVALS, // full O(N^2) energy evaluations
+  INSTR_TRAININGS,    // Hebbian weight updates (train_on and incremental add/remove)
+  INSTR_PROBES,       // hammed probes generated
+  INSTR_TRAIN_NS,     // time spent generating training patterns and training
+  INSTR_PROBE_NS,     // time spent generating probes
+  INSTR_RECALL_NS,    // time spent in recall
+  INSTR_NUM_COUNTERS
+};
+
+inline const char *instrument_name(const size_t counter) {
+  static const char *names[INSTR_NUM_COUNTERS] = {
+    "sweeps", "flips", "matvecs", "energy_evals", "trainings", "probes", "train_ns", "probe_ns", "recall_ns"
+  };
+  return names[counter];
+}
+
+#ifdef INSTRUMENT
+
+struct InstrumentBlock {
+  std::atomic<uint64_t> vals[INSTR_NUM_COUNTERS];
+  InstrumentBlock       *next;
+};
+
+inline std::atomic<InstrumentBlock*> &instrument_head() {
+  static std::atomic<InstrumentBlock*> head(nullptr);
+  return head;
+}
+
+// this thread's block (registered on first use and kept alive so totals outlive the thread)
+inline InstrumentBlock &instrument_local() {
+  static thread_local InstrumentBlock *block = nullptr;
+  if (block == nullptr) {
+    block = new InstrumentBlock();
+    for (size_t c = 0; c < INSTR_NUM_COUNTERS; c++) {
+      block->vals[c].store(0, std::memory_order_relaxed);
+    }
+    block->next = instrument_head().load();
+    while (!instrument_head().compare_exchange_weak(block->next, block)) {}
+  }
+  return *block;
+}
+
+inline void instrument_add(const size_t counter, const uint64_t n) {
+  std::atomic<uint64_t> &val = instrument_local().vals[counter];
+  val.store(val.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);  // single writer
+}
+
+// sum of every thread's counter
+inline uint64_t instrument_total(const size_t counter) {
+  uint64_t total = 0;
+  for (InstrumentBlock *block = instrument_head().load(); block != nullptr; block = block->next) {
+    total += block->vals[counter].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+class InstrumentTimer {
+public:
+  InstrumentTimer(const size_t counter) : counter_(counter), start_(std::chrono::steady_clock::now()) {}
+  ~InstrumentTimer() {
+    instrument_add(counter_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count()));
+  }
+
+private:
+  size_t                                counter_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// this thread's counters at construction (diffed against later to attribute work)
+class InstrumentSnapshot {
+public:
+  InstrumentSnapshot() {
+    InstrumentBlock &block = instrument_local();
+    for (size_t c = 0; c < INSTR_NUM_COUNTERS; c++) {
+      vals_[c] = block.vals[c].load(std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t operator()(const size_t counter) const { return vals_[counter]; }
+
+private:
+  uint64_t vals_[INSTR_NUM_COUNTERS];
+};
+
+// totals of one unit of work (e.g. a grid point) collected from any number of threads
+class InstrumentTally {
+public:
+  InstrumentTally() {
+    for (size_t c = 0; c < INSTR_NUM_COUNTERS; c++) {
+      vals_[c].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // add everything this thread counted since the snapshot was taken
+  void add_since(const InstrumentSnapshot &snapshot) {
+    InstrumentSnapshot now;
+    for (size_t c = 0; c < INSTR_NUM_COUNTERS; c++) {
+      vals_[c].fetch_add(now(c) - snapshot(c), std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t operator()(const size_t counter) const { return vals_[counter].load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> vals_[INSTR_NUM_COUNTERS];
+};
+
+#define INSTR_CONCAT_(a, b) a##b
+#define INSTR_CONCAT(a, b) INSTR_CONCAT_(a, b)
+#define INSTR_COUNT(counter, n) instrument_add((counter), static_cast<uint64_t>(n))
+#define INSTR_SCOPE(counter) InstrumentTimer INSTR_CONCAT(instrument_timer_, __LINE__)(counter)
+
+#else
+
+class InstrumentSnapshot {};
+
+class InstrumentTally {
+public:
+  void add_since(const InstrumentSnapshot &) {}
+  uint64_t operator()(const size_t) const { return 0; }
+};
+
+inline uint64_t instrument_total(const size_t) { return 0; }
+
+#define INSTR_COUNT(counter, n) ((void)0)
+#define INSTR_SCOPE(counter) ((void)0)
+
+#endif
+
+#endif
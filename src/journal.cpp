@@ -0,0 +1,237 @@
+#include "journal.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// bytes of entries collected before they are written out in one call
+#define JOURNAL_BUFFER_BYTES (1 << 16)
+
+struct JournalEntry {
+  uint32_t point, first_sim, num_sims;
+};
+
+static void journal_error(const std::string &path, const std::string &what) {
+  std::cerr << "Cannot use checkpoint " << path << ": " << what << std::endl;
+  std::exit(1);
+}
+
+// fold the bytes of value into an FNV-1a hash
+static uint64_t fingerprint_add(uint64_t hash, const uint32_t value) {
+  for (size_t b = 0; b < sizeof(value); b++) {
+    hash ^= (value >> (8 * b)) & 0xff;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+JournalHeader journal_header(const uint64_t seed, const uint32_t mode, const uint32_t test_patterns, const uint64_t sims_per_step,
+                             const uint64_t settings, const uint32_t shard, const uint32_t num_shards, const std::vector<JournalPoint> &points) {
+  uint64_t fingerprint = 14695981039346656037ULL;
+  fingerprint = fingerprint_add(fingerprint_add(fingerprint, static_cast<uint32_t>(settings)), static_cast<uint32_t>(settings >> 32));
+  for (const JournalPoint &point : points) {
+    fingerprint = fingerprint_add(fingerprint_add(fingerprint_add(fingerprint, point.neurons), point.train_patterns), point.hamming);
+  }
+
+  JournalHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+  header.version = JOURNAL_VERSION;
+  header.endian = JOURNAL_ENDIAN;
+  header.seed = seed;
+  header.mode = mode;
+  header.test_patterns = test_patterns;
+  header.num_points = points.size();
+  header.sims_per_step = sims_per_step;
+  header.fingerprint = fingerprint;
+  header.shard = shard;
+  header.num_shards = num_shards;
+  return header;
+}
+
+// read all of a file (false when it does not exist)
+static bool read_file(const std::string &path, std::vector<char> &bytes) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (errno == ENOENT) return false;
+    journal_error(path, "open failed");
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    journal_error(path, "stat failed");
+  }
+  bytes.resize(static_cast<size_t>(info.st_size));
+  size_t done = 0;
+  while (done < bytes.size()) {
+    ssize_t n = read(fd, bytes.data() + done, bytes.size() - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      close(fd);
+      journal_error(path, "read failed");
+    }
+    done += static_cast<size_t>(n);
+  }
+  close(fd);
+  return true;
+}
+
+static void check_header(const std::string &path, const JournalHeader &header) {
+  if (std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0) {
+    journal_error(path, "not a checkpoint file");
+  }
+  if (header.endian != JOURNAL_ENDIAN) {
+    journal_error(path, "written with a different byte order");
+  }
+  if (header.version != JOURNAL_VERSION) {
+    journal_error(path, "unsupported version " + std::to_string(header.version));
+  }
+}
+
+bool read_journal_header(const std::string &path, JournalHeader &header) {
+  std::vector<char> bytes;
+  if (!read_file(path, bytes)) return false;
+  if (bytes.size() < sizeof(header)) {
+    journal_error(path, "truncated header");
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  check_header(path, header);
+  if (header.num_points > (bytes.size() - sizeof(header)) / sizeof(JournalPoint)) {
+    journal_error(path, "truncated grid points");
+  }
+  return true;
+}
+
+// parse the header, points and every whole entry of a journal (entries go to replay once the
+// header matched expected, when given) and return the bytes they span, a torn last entry is left out
+static size_t parse_journal(const std::string &path, const std::vector<char> &bytes, const JournalHeader *expected,
+                            JournalHeader &header, std::vector<JournalPoint> &points, const journal_replay_t &replay) {
+  if (bytes.size() < sizeof(header)) {
+    journal_error(path, "truncated header");
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  check_header(path, header);
+  if (expected != NULL && std::memcmp(&header, expected, sizeof(header)) != 0) {
+    journal_error(path, "it belongs to a different sweep (seed, mode, grid, settings or shard changed)");
+  }
+
+  size_t valid = sizeof(header);
+  if (header.num_points > (bytes.size() - valid) / sizeof(JournalPoint)) {
+    journal_error(path, "truncated grid points");
+  }
+  points.resize(header.num_points);
+  std::memcpy(points.data(), bytes.data() + valid, header.num_points * sizeof(JournalPoint));
+  valid += header.num_points * sizeof(JournalPoint);
+
+  std::vector<uint16_t> values;
+  while (valid + sizeof(JournalEntry) <= bytes.size()) {
+    JournalEntry entry;
+    std::memcpy(&entry, bytes.data() + valid, sizeof(entry));
+    const size_t size = sizeof(entry) + entry.num_sims * sizeof(uint16_t);
+    if (valid + size > bytes.size()) break;  // torn last entry
+
+    if (entry.point >= header.num_points || entry.num_sims == 0 ||
+        static_cast<uint64_t>(entry.first_sim) + entry.num_sims > header.sims_per_step) {
+      journal_error(path, "corrupt entry at byte " + std::to_string(valid));
+    }
+    values.resize(entry.num_sims);
+    std::memcpy(values.data(), bytes.data() + valid + sizeof(entry), entry.num_sims * sizeof(uint16_t));
+    replay(entry.point, entry.first_sim, values.data(), entry.num_sims);
+    valid += size;
+  }
+  return valid;
+}
+
+bool read_journal(const std::string &path, JournalHeader &header, std::vector<JournalPoint> &points, const journal_replay_t &replay) {
+  std::vector<char> bytes;
+  if (!read_file(path, bytes)) return false;
+  parse_journal(path, bytes, NULL, header, points, replay);
+  return true;
+}
+
+SweepJournal::SweepJournal(const std::string &path, const JournalHeader &header, const std::vector<JournalPoint> &points, const bool resume, const journal_replay_t &replay)
+    : path_(path), fd_(-1), max_value_(header.test_patterns) {
+  if (header.test_patterns > 0xffff) {
+    journal_error(path, "more than 65535 test patterns do not fit its entries");
+  }
+
+  std::vector<char> bytes;
+  size_t valid = 0;  // bytes of header, points and whole entries
+  if (resume && read_file(path, bytes) && bytes.size() >= sizeof(header)) {
+    JournalHeader found;
+    std::vector<JournalPoint> found_points;
+    valid = parse_journal(path, bytes, &header, found, found_points, replay);
+  }
+
+  if (valid > 0) {
+    // continue after the last whole entry
+    fd_ = open(path.c_str(), O_WRONLY);
+    if (fd_ < 0 || ftruncate(fd_, static_cast<off_t>(valid)) != 0 || lseek(fd_, 0, SEEK_END) < 0) {
+      journal_error(path, "reopen for appending failed");
+    }
+  } else {
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      journal_error(path, "open for writing failed");
+    }
+    const char *head = reinterpret_cast<const char*>(&header);
+    buf_.assign(head, head + sizeof(header));
+    const char *table = reinterpret_cast<const char*>(points.data());
+    buf_.insert(buf_.end(), table, table + points.size() * sizeof(JournalPoint));
+  }
+  buf_.reserve(JOURNAL_BUFFER_BYTES + 4096);
+}
+
+SweepJournal::~SweepJournal() {
+  if (fd_ >= 0) close();
+}
+
+void SweepJournal::record(const size_t point, const size_t first_sim, const double *vals, const size_t num_sims) {
+  JournalEntry entry = {static_cast<uint32_t>(point), static_cast<uint32_t>(first_sim), static_cast<uint32_t>(num_sims)};
+
+  std::lock_guard<std::mutex> guard(lock_);
+  const char *head = reinterpret_cast<const char*>(&entry);
+  buf_.insert(buf_.end(), head, head + sizeof(entry));
+  for (size_t j = 0; j < num_sims; j++) {
+    uint16_t value = static_cast<uint16_t>(std::min(vals[j], static_cast<double>(max_value_)));
+    const char *bytes = reinterpret_cast<const char*>(&value);
+    buf_.insert(buf_.end(), bytes, bytes + sizeof(value));
+  }
+
+  if (buf_.size() >= JOURNAL_BUFFER_BYTES) {
+    write_out();
+  }
+}
+
+// write the buffered entries (holding lock_)
+void SweepJournal::write_out() {
+  size_t done = 0;
+  while (done < buf_.size()) {
+    ssize_t n = write(fd_, buf_.data() + done, buf_.size() - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      journal_error(path_, std::string("write failed (") + std::strerror(errno) + ")");
+    }
+    done += static_cast<size_t>(n);
+  }
+  buf_.clear();
+}
+
+void SweepJournal::checkpoint() {
+  std::lock_guard<std::mutex> guard(lock_);
+  write_out();
+  if (fsync(fd_) != 0) {
+    journal_error(path_, "fsync failed");
+  }
+}
+
+void SweepJournal::close() {
+  checkpoint();
+  ::close(fd_);
+  fd_ = -1;
+}
@@ -0,0 +1,83 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+// append-only binary checkpoint of a proportion sweep: which simulations of which grid points are done
+// and what they found, so an interrupted sweep resumes without redoing them (and the shards of a sweep
+// can be merged, see merge.cpp)
+//   [JournalHeader (64 bytes)] [JournalPoint of every grid point] [entry] [entry] ...
+//   entry: uint32 point, uint32 first_sim, uint32 num_sims, then num_sims uint16 converged counts
+// the random stream of a simulation is keyed by its grid point and index (simulation_rng), so the
+// entries are all the state a resumed run needs: a missing simulation restarts from its own stream.
+// entries are written whole, a torn last entry (the process died while writing) is dropped on resume
+#define JOURNAL_MAGIC "HOPFJRNL"
+#define JOURNAL_VERSION 3
+#define JOURNAL_ENDIAN 0x01020304u
+
+// the sweep a journal belongs to, a resumed run must match every field
+struct JournalHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint64_t seed;          // master seed
+  uint32_t mode;          // SweepMode
+  uint32_t test_patterns;
+  uint64_t num_points;
+  uint64_t sims_per_step;
+  uint64_t fingerprint;   // hash of the points and the result settings (FNV-1a)
+  uint32_t shard;         // which part of the sweep's tasks this run simulates (0 of 1 unless sharded)
+  uint32_t num_shards;
+};
+static_assert(sizeof(JournalHeader) == 64, "journal header layout changed, bump JOURNAL_VERSION");
+
+// (neurons, trained patterns, hamming) of a grid point, in grid order after the header
+struct JournalPoint {
+  uint32_t neurons, train_patterns, hamming;
+};
+
+// settings are the other parameters that change what the simulations find (see result_settings)
+JournalHeader journal_header(const uint64_t seed, const uint32_t mode, const uint32_t test_patterns, const uint64_t sims_per_step,
+                             const uint64_t settings, const uint32_t shard, const uint32_t num_shards, const std::vector<JournalPoint> &points);
+
+// one (first_sim, num_sims) run of simulations of a grid point read back from a journal
+typedef std::function<void(size_t point, size_t first_sim, const uint16_t *values, size_t num_sims)> journal_replay_t;
+
+// read the header of the journal at path (false when there is none)
+bool read_journal_header(const std::string &path, JournalHeader &header);
+
+// read a whole journal, its entries are passed to replay (false when there is none)
+bool read_journal(const std::string &path, JournalHeader &header, std::vector<JournalPoint> &points, const journal_replay_t &replay);
+
+class SweepJournal {
+public:
+  // journal of the sweep described by header and points at path, started over unless resume is set and
+  // path holds a journal of the same sweep, whose entries are then passed to replay before appending to it
+  SweepJournal(const std::string &path, const JournalHeader &header, const std::vector<JournalPoint> &points, const bool resume, const journal_replay_t &replay);
+  ~SweepJournal();
+  SweepJournal(const SweepJournal &) = delete;
+  SweepJournal &operator=(const SweepJournal &) = delete;
+
+  // note that simulations first_sim.. of point found vals (any thread)
+  void record(const size_t point, const size_t first_sim, const double *vals, const size_t num_sims);
+
+  // write out every entry recorded so far and fsync it (any thread)
+  void checkpoint();
+  void close();
+
+private:
+  void write_out();
+
+  std::string       path_;
+  int               fd_;
+  uint32_t          max_value_;
+  std::mutex        lock_;
+  std::vector<char> buf_;
+};
+
+#endif
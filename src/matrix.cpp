@@ -1,12 +1,19 @@
 #include "matrix.hpp"
 #include "vector.hpp"
 #include "util.hpp"
+#include "recall.hpp"
+#include "arena.hpp"
 #include <omp.h>
 #include <iostream>
+#include <algorithm>
+
+// tile edge (in neurons) of the blocked hebbian kernel
+#define HEBB_BLOCK 64
 
 // matrix-vector multiplication (optimized with hoisting) and vectorization
 template<typename T, typename C>
 void matmult(Matrix<T> *m, const Vector<C>& x, Vector<C>& y) {
+  INSTR_COUNT(INSTR_MATVECS, 1);
   #pragma omp simd
   for (size_t i = 0; i < m->num_rows(); ++i) {
     C hoist = 0.0;
@@ -35,6 +42,18 @@ C matmultvec(Matrix<T> *m, const size_t row, const Vector<C>& x) {
   return hoist;
 }
 
+template<typename T, typename C>
+void matmult(Matrix<T> *m, const PackedPattern& s, Vector<C>& y) {
+  INSTR_COUNT(INSTR_MATVECS, 1);
+  for (size_t i = 0; i < m->num_rows(); ++i) {
+    y(i) += static_cast<C>(bipolar_dot(&m->operator()(i, 0), s.words(), m->num_cols()));
+  }
+}
+
+template<typename T>
+T matmultvec(Matrix<T> *m, const size_t row, const PackedPattern& s) {
+  return bipolar_dot(&m->operator()(row, 0), s.words(), m->num_cols());
+}
 
 template <typename T>
 void Matrix<T>::set_all(const T &val) {
@@ -46,6 +65,7 @@ void Matrix<T>::set_all(const T &val) {
 template <typename T>
 void Matrix<T>::zeroize() {
     set_all(0.0);
+    num_patterns_ = 0;
 }
 
 template <typename T>
@@ -67,7 +87,7 @@ Matrix<short> Matrix<T>::truncshort() {
   for(size_t i = 0; i < ndata.size(); i++) {
     ndata.at(i) = static_cast<short>(trunc(storage_.at(i)));
   }
-  return Matrix<short>(num_rows(), num_cols(), ndata);
+  return Matrix<short>(num_rows(), num_cols(), std::move(ndata));
 }
 
 template <typename T>
@@ -76,24 +96,29 @@ Matrix<int> Matrix<T>::truncint() {
   for(size_t i = 0; i < ndata.size(); i++) {
     ndata.at(i) = static_cast<int>(trunc(storage_.at(i)));
   }
-  return Matrix<int>(num_rows(), num_cols(), ndata);
+  return Matrix<int>(num_rows(), num_cols(), std::move(ndata));
 }
 
+// synchronous update straight from the packed states (no double round trip)
 template<typename T>
-pattern_t Matrix<T>::update(pattern_t &pattern) {
-  Vector<double> d_pattern = pattern.convert<double>(); // convert pattern to double
-  Vector<double> out(d_pattern.num_rows());
+pattern_t Matrix<T>::update(const pattern_t &pattern) {
+  const PackedPattern bits(pattern);
+  pattern_t out(num_rows());
 
-  // apply update inner (more efficient if called directly)
-  // requires less copying
-  this->update(d_pattern, out);
-
-  // convert back from double to original type
-  return out.convert<short>();
+  for (size_t i = 0; i < num_rows(); i++) {
+    const double h = static_cast<double>(bipolar_dot(&storage_[i * num_cols_], bits.words(), num_cols()));
+    if (dcompare(h, 0.0)) {
+      out(i) = pattern(i); // copy previous state
+    } else {
+      out(i) = vsign<double, short>(h); // get -1/1 sign
+    }
+  }
+  INSTR_COUNT(INSTR_MATVECS, 1);
+  return out;
 }
 
 template<typename T>
-void Matrix<T>::update(const Vector<double> in, Vector<double> &out) {
+void Matrix<T>::update(const Vector<double> &in, Vector<double> &out) {
   // apply matrix mult for synchronous update
   out.zeroize();
   matmult<T, double>(this, in, out);
@@ -110,94 +135,161 @@ void Matrix<T>::update(const Vector<double> in, Vector<double> &out) {
   }
 }
 
+// asynchronous recall until a full sweep changes no neuron (see recall.hpp)
 template<typename T>
-size_t Matrix<T>::run_to_min(const pattern_t &pattern, pattern_t &out_pattern) {
-  size_t steps = 0;
+size_t Matrix<T>::run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng) const {
+  Recall<Matrix<T>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
+
+  return steps;
+}
 
-  // calculate initial energy
-  double energy = this->energy(pattern);
+template<typename T>
+size_t Matrix<T>::run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng) const {
+  Recall<Matrix<T>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
 
-  // convert to doubles
-  Vector<double> o_pattern = pattern.convert<double>();
+  return steps;
+}
 
-  // create vector of indices (from original pattern)
-  std::vector<size_t> indx(pattern.num_rows());
-  for (size_t i = 0; i < indx.size(); i++) {
-    indx[i] = i;
-  }
+// recall a whole set of probes in batches (see BatchRecall in recall.hpp)
+// out_patterns is resized to match and the number of batch sweeps is returned
+template<typename T>
+size_t Matrix<T>::run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<Matrix<T>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
 
-  std::random_device rand_dev;
-  std::mt19937 generator(rand_dev());
-  std::uniform_int_distribution<size_t> distr(0, indx.size() - 1);
-
-  // only continue to update while the energy is changing
-  size_t not_changed = 0;
-  while (true) {
-    // randomly shuffle indices
-    std::shuffle(indx.begin(), indx.end(), generator);
-
-    // increase steps
-    steps++;
-
-    // go through all neurons/states and apply threshold
-    for (size_t i = 0; i < indx.size(); i++) {
-      size_t ind = indx[i];  // distr(generator);
-      double nvalue = matmultvec(this, ind, o_pattern); // apply threshold function
-      if(nvalue > EPS) {  // update value only if it has changed
-        o_pattern(ind) = 1.0;
-      } else if (nvalue < EPS) {
-        o_pattern(ind) = -1.0;
-      }
-    }
-    double nenergy = this->energy(o_pattern);
+template<typename T>
+size_t Matrix<T>::run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<Matrix<T>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
 
-    // check if energy has changed
-    if (dcompare(energy, nenergy)) {
-      not_changed++;
-      if (not_changed >= 5) {
-        break;
-      }
-    } else {
-      not_changed = 0;
-    }
-    
-    // copy new energy
-    energy = nenergy; 
+template<typename T>
+void Matrix<T>::train_on(patterns_t &patterns) {
+  // pack into bits and use the blocked kernel
+  packed_patterns_t packed;
+  packed.reserve(patterns.size());
+  for (size_t p = 0; p < patterns.size(); ++p) {
+    packed.push_back(PackedPattern(patterns.at(p)));
   }
+  train_on(packed);
+}
 
-  // copy back to output
-  for (size_t i = 0; i < num_rows(); i++) {
-    out_pattern(i) = static_cast<short>(floor(o_pattern(i)));
+// Hebb's rule as the rank-P update W = X^T X / P with a zero diagonal
+// (overwrites the weights)
+template<typename T>
+void Matrix<T>::train_on(packed_patterns_t &patterns) {
+  if (patterns.empty()) {
+    zeroize();
+    return;
   }
 
-  return steps;
+  hebbian(patterns, 0.0, 1.0 / static_cast<double>(patterns.size()));
+  num_patterns_ = patterns.size();
 }
 
 template<typename T>
-void Matrix<T>::train_on(patterns_t &patterns) {
-  const double pattern_n = static_cast<double>(patterns.size());
-  
-  // train on every pattern
-  for (size_t p = 0; p < patterns.size(); ++p) {
-    Vector<double> patt = patterns.at(p).convert<double>(); // cache pattern (converted to doubles)
-    for (size_t i = 0; i < num_rows(); ++i) {
-      double ival = patt(i); // cache value
-      for (size_t j = 0; j < num_cols(); ++j) {
-        double val = ival*patt(j); // Hebb's rule
-        storage_[i * num_cols_ + j] += val; // setting w_ij
-        storage_[j * num_cols_ + i] += val; // setting w_ji
-      }
-    }
+void Matrix<T>::add_pattern(const packed_pattern_t &pattern) {
+  add_patterns(packed_patterns_t(1, pattern));
+}
+
+// W' = (P W + X^T X) / (P + dP)
+template<typename T>
+void Matrix<T>::add_patterns(const packed_patterns_t &patterns) {
+  if (patterns.empty()) return;
+
+  const double old_n = static_cast<double>(num_patterns_);
+  const double new_n = static_cast<double>(num_patterns_ + patterns.size());
+  hebbian(patterns, old_n / new_n, 1.0 / new_n);
+  num_patterns_ += patterns.size();
+}
+
+template<typename T>
+void Matrix<T>::remove_pattern(const packed_pattern_t &pattern) {
+  remove_patterns(packed_patterns_t(1, pattern));
+}
+
+// W' = (P W - X^T X) / (P - dP), unlearning every pattern leaves zero weights
+template<typename T>
+void Matrix<T>::remove_patterns(const packed_patterns_t &patterns) {
+  if (patterns.empty()) return;
+  if (patterns.size() > num_patterns_) {
+    std::cerr << "Cannot remove " << patterns.size() << " patterns from a network trained on " << num_patterns_ << std::endl;
+    std::exit(1);
   }
 
-  // divide valus by p (for Hebb's rule)
-  for (size_t i = 0; i < storage_.size(); i++) {
-    storage_[i] /= pattern_n;
+  if (patterns.size() == num_patterns_) {
+    zeroize();
+    return;
   }
 
-  // zero out diagonal
-  for (size_t i = 0; i < num_rows(); i++) {
-    storage_[i * num_cols_ + i] = 0.0;
+  const double old_n = static_cast<double>(num_patterns_);
+  const double new_n = static_cast<double>(num_patterns_ - patterns.size());
+  hebbian(patterns, old_n / new_n, -1.0 / new_n);
+  num_patterns_ -= patterns.size();
+}
+
+// w_ij = keep * w_ij + scale * (x_i . x_j) for i != j and w_ii = 0.
+// With the patterns transposed into one bit row per neuron,
+// x_i . x_j = P - 2 * popcount(bits_i ^ bits_j), so only the upper triangle is
+// computed tile by tile and each tile is mirrored while still in cache
+template<typename T>
+void Matrix<T>::hebbian(const packed_patterns_t &patterns, const double keep, const double scale) {
+  INSTR_COUNT(INSTR_TRAININGS, 1);
+  const size_t N = num_rows();
+
+  // the P states of neuron i live in bits[i * pw .. (i + 1) * pw)
+  Scratch<PackedPattern::word_t, SCRATCH_BITS> bits_lease;
+  std::vector<PackedPattern::word_t> &bits = *bits_lease;
+  const size_t pw = transpose_patterns(patterns, bits);
+  const double pattern_n = static_cast<double>(patterns.size());
+  const size_t nblocks = (N + HEBB_BLOCK - 1) / HEBB_BLOCK;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t bi = 0; bi < nblocks; bi++) {
+    const size_t i0 = bi * HEBB_BLOCK;
+    const size_t i1 = std::min(N, i0 + HEBB_BLOCK);
+
+    for (size_t bj = bi; bj < nblocks; bj++) {
+      const size_t j0 = bj * HEBB_BLOCK;
+      const size_t j1 = std::min(N, j0 + HEBB_BLOCK);
+
+      // upper triangle of the tile (scaling folded in, diagonal zeroed in place)
+      for (size_t i = i0; i < i1; i++) {
+        const PackedPattern::word_t *xi = &bits[i * pw];
+        T *row = &storage_[i * num_cols_];
+        const size_t js = std::max(j0, i + 1);
+        if (bi == bj) {
+          row[i] = 0;
+        }
+
+        #pragma omp simd
+        for (size_t j = js; j < j1; j++) {
+          const PackedPattern::word_t *xj = &bits[j * pw];
+          long diff = 0;
+          for (size_t w = 0; w < pw; w++) {
+            diff += __builtin_popcountll(xi[w] ^ xj[w]);
+          }
+          const double dot = pattern_n - 2.0 * static_cast<double>(diff);
+          row[j] = static_cast<T>(((keep == 0.0) ? 0.0 : keep * static_cast<double>(row[j])) + scale * dot);
+        }
+      }
+
+      // mirror the tile into the lower triangle
+      for (size_t j = j0; j < j1; j++) {
+        T *row = &storage_[j * num_cols_];
+        const size_t ie = std::min(i1, j);
+        for (size_t i = i0; i < ie; i++) {
+          row[i] = storage_[i * num_cols_ + j];
+        }
+      }
+    }
   }
 }
 
@@ -229,3 +321,7 @@ void delete_hopfield(hopfield_pt ptr) {
 template class Matrix<int>;
 template class Matrix<double>;
 template class Matrix<short>;
+template void matmult<double, double>(Matrix<double> *, const Vector<double>&, Vector<double>&);
+template double matmultvec<double, double>(Matrix<double> *, const size_t, const Vector<double>&);
+template void matmult<double, double>(Matrix<double> *, const PackedPattern&, Vector<double>&);
+template double matmultvec<double>(Matrix<double> *, const size_t, const PackedPattern&);
@@ -7,16 +7,26 @@
 #include <type_traits>
 #include <iostream>
 #include <tuple>
+#include <algorithm>
+#include <utility>
 #include <omp.h>
 #include "vector.hpp"
+#include "packed.hpp"
+#include "bipolar.hpp"
+#include "instrument.hpp"
 #include "util.hpp"
 
+// tile of the weight matrix kept in cache while a whole batch of probes streams over it
+#define BATCH_BLOCK_ROWS 64
+#define BATCH_BLOCK_COLS 512
+
 template<typename T>
 class Matrix {
 public:
-  Matrix(size_t N) : num_rows_(N), num_cols_(N), storage_(num_rows_ * num_cols_) {}
-  Matrix(size_t M, size_t N) : num_rows_(M), num_cols_(N), storage_(num_rows_ * num_cols_) {}
-  Matrix(size_t M, size_t N, const std::vector<T> &W) : num_rows_(M), num_cols_(N), storage_(W) {}
+  Matrix(size_t N) : num_rows_(N), num_cols_(N), num_patterns_(0), storage_(num_rows_ * num_cols_) {}
+  Matrix(size_t M, size_t N) : num_rows_(M), num_cols_(N), num_patterns_(0), storage_(num_rows_ * num_cols_) {}
+  Matrix(size_t M, size_t N, const std::vector<T> &W) : num_rows_(M), num_cols_(N), num_patterns_(0), storage_(W) {}
+  Matrix(size_t M, size_t N, std::vector<T> &&W) : num_rows_(M), num_cols_(N), num_patterns_(0), storage_(std::move(W)) {}
 
         T& operator()(size_t i, size_t j)       { return storage_[i * num_cols_ + j]; }
   const T& operator()(size_t i, size_t j) const { return storage_[i * num_cols_ + j]; }
@@ -37,7 +47,7 @@ public:
     for(size_t i = 0; i < ndata.size(); i++) {
       ndata.at(i) = static_cast<C>(storage_.at(i));
     }
-    return Matrix<C>(num_rows(), num_cols(), ndata);
+    return Matrix<C>(num_rows(), num_cols(), std::move(ndata));
   }
 
   Matrix<short> truncshort();
@@ -49,11 +59,13 @@ public:
     for(size_t i = 0; i < ndata.size(); i++) {
       ndata.at(i) = vsign<T, C>(storage_.at(i));
     }
-    return Matrix<C>(num_rows(), num_cols(), ndata);
+    return Matrix<C>(num_rows(), num_cols(), std::move(ndata));
   }
 
-  template<typename C>
-  double energy(const Vector<C> &pattern) {
+  // works on any pattern type with -1/1 operator() access (Vector<C> or PackedPattern)
+  template<typename P>
+  double energy(const P &pattern) {
+    INSTR_COUNT(INSTR_ENERGY_EVALS, 1);
     double e = 0.0;
 
     for (size_t i = 0; i < num_rows(); i++) {
@@ -66,10 +78,108 @@ public:
     return 0.5 * e;
   }
 
+  // local fields h = W x for every neuron
+  template<typename F>
+  void fields(const F *x, F *h) const {
+    for (size_t i = 0; i < num_rows(); i++) {
+      const T *row = &storage_[i * num_cols_];
+      F hoist = 0.0;
+
+      #pragma omp simd reduction(+:hoist)
+      for (size_t j = 0; j < num_cols(); j++) {
+        hoist += static_cast<F>(row[j]) * x[j];
+      }
+      h[i] = hoist;
+    }
+  }
+
+  // local fields from packed -1/1 states (multiply-free, see bipolar.hpp)
+  template<typename F>
+  void fields(const PackedPattern &s, F *h) const {
+    for (size_t i = 0; i < num_rows(); i++) {
+      h[i] = static_cast<F>(bipolar_dot(&storage_[i * num_cols_], s.words(), num_cols()));
+    }
+  }
+
+  // local fields of a batch of probes h[b * ld + i] = (W x_b)_i for b < count
+  // (cache-blocked matrix-matrix product, each weight load is reused for 4 probes)
+  template<typename F>
+  void fields_batch(const F *x, F *h, const size_t count, const size_t ld) const {
+    for (size_t b = 0; b < count; b++) {
+      std::fill(h + b * ld, h + b * ld + num_rows(), static_cast<F>(0));
+    }
+
+    for (size_t j0 = 0; j0 < num_cols(); j0 += BATCH_BLOCK_COLS) {
+      const size_t j1 = std::min(num_cols(), j0 + BATCH_BLOCK_COLS);
+      for (size_t i0 = 0; i0 < num_rows(); i0 += BATCH_BLOCK_ROWS) {
+        const size_t i1 = std::min(num_rows(), i0 + BATCH_BLOCK_ROWS);
+
+        size_t b = 0;
+        for (; b + 4 <= count; b += 4) {
+          const F *x0 = x + b * ld, *x1 = x0 + ld, *x2 = x1 + ld, *x3 = x2 + ld;
+          for (size_t i = i0; i < i1; i++) {
+            const T *row = &storage_[i * num_cols_];
+            F a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0;
+
+            #pragma omp simd reduction(+:a0,a1,a2,a3)
+            for (size_t j = j0; j < j1; j++) {
+              const F w = static_cast<F>(row[j]);
+              a0 += w * x0[j];
+              a1 += w * x1[j];
+              a2 += w * x2[j];
+              a3 += w * x3[j];
+            }
+            h[b * ld + i] += a0;
+            h[(b + 1) * ld + i] += a1;
+            h[(b + 2) * ld + i] += a2;
+            h[(b + 3) * ld + i] += a3;
+          }
+        }
+
+        // remaining probes one at a time
+        for (; b < count; b++) {
+          const F *xb = x + b * ld;
+          for (size_t i = i0; i < i1; i++) {
+            const T *row = &storage_[i * num_cols_];
+            F a0 = 0.0;
+
+            #pragma omp simd reduction(+:a0)
+            for (size_t j = j0; j < j1; j++) {
+              a0 += static_cast<F>(row[j]) * xb[j];
+            }
+            h[b * ld + i] += a0;
+          }
+        }
+      }
+    }
+  }
+
+  // h += scale * W[:, k] (weights are symmetric so column k is the contiguous row k)
+  template<typename F>
+  void add_column(size_t k, const F &scale, F *h) const {
+    const T *col = &storage_[k * num_cols_];
+
+    #pragma omp simd
+    for (size_t j = 0; j < num_cols(); j++) {
+      h[j] += scale * static_cast<F>(col[j]);
+    }
+  }
+
   void train_on(std::vector<Vector<short>> &patterns);
-  pattern_t update(pattern_t &pattern);
-  void update(const Vector<double> in, Vector<double> &out);
-  size_t run_to_min(const pattern_t &pattern, pattern_t &out_pattern);
+  void train_on(packed_patterns_t &patterns);
+
+  // incremental Hebbian learning on top of the current weights (keeps the 1/P normalization)
+  void add_pattern(const packed_pattern_t &pattern);
+  void add_patterns(const packed_patterns_t &patterns);
+  void remove_pattern(const packed_pattern_t &pattern);
+  void remove_patterns(const packed_patterns_t &patterns);
+  size_t num_patterns() const { return num_patterns_; }
+  pattern_t update(const pattern_t &pattern);
+  void update(const Vector<double> &in, Vector<double> &out);
+  size_t run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
 
   void print() {
     for (size_t i = 0; i < num_rows(); i++) {
@@ -85,10 +195,27 @@ public:
   size_t num_cols() const { return num_cols_; }
 
 private:
+  void hebbian(const packed_patterns_t &patterns, const double keep, const double scale);
+
   size_t              num_rows_, num_cols_;
+  size_t              num_patterns_; // patterns the weights are currently normalized by
   std::vector<T> storage_;
 };
 
+// dense kernels (y += M x and a single row of M x)
+template<typename T, typename C>
+void matmult(Matrix<T> *m, const Vector<C>& x, Vector<C>& y);
+
+template<typename T, typename C>
+C matmultvec(Matrix<T> *m, const size_t row, const Vector<C>& x);
+
+// the same for bipolar states, selected by the packed state type (y += M s and a single row of M s)
+template<typename T, typename C>
+void matmult(Matrix<T> *m, const PackedPattern& s, Vector<C>& y);
+
+template<typename T>
+T matmultvec(Matrix<T> *m, const size_t row, const PackedPattern& s);
+
 typedef Matrix<double> hopfield_t;
 typedef Matrix<double>* hopfield_pt;
 
@@ -0,0 +1,101 @@
+#include "journal.hpp"
+#include "sink.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+
+static void merge_error(const std::string &what) {
+  std::cerr << "Cannot merge: " << what << std::endl;
+  std::exit(1);
+}
+
+// combine the journals of the shards of a sweep (./hopfield --seed N --shard i/k) into the result files of
+// the whole sweep. The converged count of every simulation is gathered per grid point and summarized as an
+// unsharded run does, so min/mean/std and the percentiles are those of all simulations (exact, percentiles of
+// per shard statistics can not be combined) and the files equal those of an unsharded run with the same seed
+int main(int argc, char* argv[]) {
+  // --format csv|npy|both as for ./hopfield, --out the base name of the result files
+  int format = RESULTS_CSV;
+  std::string out = "proportion-data";
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--format") == 0 && (i + 1) < argc) {
+      i++;
+      if (strcmp(argv[i], "csv") == 0) {
+        format = RESULTS_CSV;
+      } else if (strcmp(argv[i], "npy") == 0) {
+        format = RESULTS_NPY;
+      } else if (strcmp(argv[i], "both") == 0) {
+        format = RESULTS_BOTH;
+      } else {
+        merge_error(std::string("unknown result format ") + argv[i] + " (csv, npy or both)");
+      }
+    } else if (strcmp(argv[i], "--out") == 0 && (i + 1) < argc) {
+      out = argv[++i];
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [--format csv|npy|both] [--out proportion-data] proportion-shard-0-of-k.bin ..." << std::endl;
+    return 1;
+  }
+
+  // every file has to be a different shard of the same sweep
+  JournalHeader sweep;
+  if (!read_journal_header(paths[0], sweep)) {
+    merge_error(paths[0] + " does not exist");
+  }
+  std::vector<bool> seen(sweep.num_shards, false);
+  for (const std::string &path : paths) {
+    JournalHeader header;
+    if (!read_journal_header(path, header)) {
+      merge_error(path + " does not exist");
+    }
+    if (header.seed != sweep.seed || header.mode != sweep.mode || header.test_patterns != sweep.test_patterns ||
+        header.num_points != sweep.num_points || header.sims_per_step != sweep.sims_per_step ||
+        header.fingerprint != sweep.fingerprint || header.num_shards != sweep.num_shards || header.shard >= header.num_shards) {
+      merge_error(path + " is not a shard of the same sweep as " + paths[0]);
+    }
+    if (seen[header.shard]) {
+      merge_error(path + " repeats shard " + std::to_string(header.shard));
+    }
+    seen[header.shard] = true;
+  }
+  for (size_t s = 0; s < seen.size(); s++) {
+    if (!seen[s]) {
+      merge_error("shard " + std::to_string(s) + " of " + std::to_string(sweep.num_shards) + " is missing");
+    }
+  }
+
+  // gather the simulations of every point (at their index, so the sums run in the same order as unsharded)
+  std::vector<std::vector<double>> vals(sweep.num_points, std::vector<double>(sweep.sims_per_step, 0.0));
+  std::vector<std::vector<bool>> present(sweep.num_points, std::vector<bool>(sweep.sims_per_step, false));
+  std::vector<JournalPoint> points;
+  for (const std::string &path : paths) {
+    JournalHeader header;
+    read_journal(path, header, points, [&](size_t p, size_t first_sim, const uint16_t *values, size_t num_sims) {
+      for (size_t j = 0; j < num_sims; j++) {
+        vals[p][first_sim + j] = static_cast<double>(values[j]);
+        present[p][first_sim + j] = true;
+      }
+    });
+  }
+
+  ResultSink<ProportionRecord> sink(out, format, sweep.num_points);
+  for (size_t p = 0; p < sweep.num_points; p++) {
+    const size_t sims = static_cast<size_t>(std::count(present[p].begin(), present[p].end(), true));
+    if (sims != sweep.sims_per_step) {
+      merge_error("grid point " + std::to_string(p) + " has " + std::to_string(sims) + " of " + std::to_string(sweep.sims_per_step)
+                  + " simulations, finish its shards first (--resume)");
+    }
+    sink.put(p, summarize_proportion(points[p].neurons, points[p].train_patterns, sweep.test_patterns, points[p].hamming, vals[p]));
+  }
+  sink.close();
+
+  std::cout << "Merged " << paths.size() << " shards of " << sweep.num_points << " grid points (master seed " << sweep.seed << ") into " << out << std::endl;
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include "packed.hpp"
+#include "util.hpp"
+#include "arena.hpp"
+#include <algorithm>
+
+void PackedPattern::set_all(const short &val) {
+  std::fill(storage_.begin(), storage_.end(), (val > 0) ? ~word_t(0) : word_t(0));
+  if (!storage_.empty()) {
+    storage_.back() &= tail_mask();  // keep padding cleared
+  }
+}
+
+void PackedPattern::randomize(Rng &rng) {
+  // every random word gives 64 neurons a 1/2 prob of being 1,-1
+  rng.fill(storage_.data(), storage_.size());
+  if (!storage_.empty()) {
+    storage_.back() &= tail_mask();  // keep padding cleared
+  }
+}
+
+void make_random_patterns(const size_t neurons, packed_patterns_t &patts, const size_t num, Rng &rng) {
+    // create random patterns
+    for (size_t i = 0; i < num; i++) {
+      packed_pattern_t npattern(neurons);
+      npattern.randomize(rng);
+      patts.push_back(std::move(npattern));
+    }
+}
+
+void make_hammed_patterns(const packed_pattern_t &orig, packed_patterns_t &patts, const size_t num, const size_t distance, bool incremental, Rng &rng) {
+    // create vector of indices (from original pattern)
+    Scratch<size_t, SCRATCH_HAMMED> indx_lease;
+    std::vector<size_t> &indx = *indx_lease;
+    indx.resize(orig.num_rows());
+    for (size_t i = 0; i < indx.size(); i++) {
+      indx[i] = i;
+    }
+
+    // randomly shuffle indices (only the ones that will be flipped need drawing)
+    rng.partial_shuffle(indx.begin(), indx.end(), num * distance);
+
+    // for each new pattern flip the bits of the next distance shuffled indices
+    for (size_t i = 0; i < num; i++) {
+      // copy original (or if incremental then last one)
+      packed_pattern_t patt = (incremental) ? (patts.at(i).copy()) : orig.copy();
+
+      for (size_t j = (i*distance); j < ((i + 1)*distance); j++) {
+        patt.flip(indx[j % orig.num_rows()]);  // flip a random index
+      }
+
+      // add the new pattern
+      patts.push_back(std::move(patt));
+    }
+}
+
+void fill_random_patterns(const size_t neurons, packed_patterns_t &patts, const size_t first, const size_t num, Rng &rng) {
+    size_patterns(patts, first + num, neurons);
+    for (size_t i = first; i < first + num; i++) {
+      patts[i].randomize(rng);
+    }
+}
+
+void fill_hammed_patterns(const packed_pattern_t &orig, packed_patterns_t &patts, const size_t first, const size_t num, const size_t distance, Rng &rng) {
+    Scratch<size_t, SCRATCH_HAMMED> indx_lease;
+    std::vector<size_t> &indx = *indx_lease;
+    indx.resize(orig.num_rows());
+    for (size_t i = 0; i < indx.size(); i++) {
+      indx[i] = i;
+    }
+
+    rng.partial_shuffle(indx.begin(), indx.end(), num * distance);
+
+    // copy assignment keeps the storage of the pattern being overwritten
+    size_patterns(patts, first + num, orig.num_rows());
+    for (size_t i = 0; i < num; i++) {
+      packed_pattern_t &patt = patts[first + i];
+      patt = orig;
+      for (size_t j = (i*distance); j < ((i + 1)*distance); j++) {
+        patt.flip(indx[j % orig.num_rows()]);
+      }
+    }
+}
+
+// transpose P patterns into one row of P bits per neuron (returns words per row)
+size_t transpose_patterns(const packed_patterns_t &patts, std::vector<PackedPattern::word_t> &bits) {
+    const size_t num = patts.size();
+    const size_t neurons = (num == 0) ? 0 : patts.at(0).num_rows();
+    const size_t pw = PackedPattern::words_for(num);
+    bits.assign(neurons * pw, 0);
+
+    // every group of 64 patterns writes its own word of each neuron row
+    #pragma omp parallel for
+    for (size_t pg = 0; pg < pw; pg++) {
+      const size_t pend = std::min(num, (pg + 1) * PackedPattern::WORD_BITS);
+      for (size_t p = pg * PackedPattern::WORD_BITS; p < pend; p++) {
+        const PackedPattern::word_t pbit = PackedPattern::word_t(1) << (p % PackedPattern::WORD_BITS);
+        const PackedPattern::word_t *words = patts[p].words();
+
+        // walk only the set bits of the pattern
+        for (size_t w = 0; w < patts[p].num_words(); w++) {
+          PackedPattern::word_t word = words[w];
+          while (word) {
+            const size_t i = w * PackedPattern::WORD_BITS + static_cast<size_t>(__builtin_ctzll(word));
+            bits[i * pw + pg] |= pbit;
+            word &= word - 1;
+          }
+        }
+      }
+    }
+    return pw;
+}
@@ -0,0 +1,119 @@
+#ifndef PACKED_HPP
+#define PACKED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include "vector.hpp"
+#include "util.hpp"
+
+// bit-packed bipolar pattern (one bit per neuron stored in 64-bit words)
+// a set bit is a +1 state and a cleared bit is a -1 state, the padding bits
+// past num_rows() are always kept cleared so whole words can be compared
+class PackedPattern {
+public:
+  typedef uint64_t word_t;
+  static const size_t WORD_BITS = 64;
+
+  PackedPattern(size_t M) : num_rows_(M), storage_(words_for(M), 0) {}
+
+  // pack any -1/1 vector (anything > 0 is treated as +1)
+  template<typename C>
+  explicit PackedPattern(const Vector<C> &pattern) : num_rows_(pattern.num_rows()), storage_(words_for(pattern.num_rows()), 0) {
+    for (size_t i = 0; i < num_rows(); i++) {
+      if (pattern(i) > 0) {
+        storage_[i / WORD_BITS] |= bit(i);
+      }
+    }
+  }
+
+  short operator()(size_t i) const { return (storage_[i / WORD_BITS] & bit(i)) ? 1 : -1; }
+
+  void set(size_t i, const short &val) {
+    if (val > 0) {
+      storage_[i / WORD_BITS] |= bit(i);
+    } else {
+      storage_[i / WORD_BITS] &= ~bit(i);
+    }
+  }
+
+  void flip(size_t i) { storage_[i / WORD_BITS] ^= bit(i); }
+
+  void set_all(const short &);
+  void randomize(Rng &rng = thread_rng());
+
+  PackedPattern copy() const {
+    return PackedPattern(*this);
+  }
+
+  void copy_from(const PackedPattern &other) {
+    std::copy(other.storage_.begin(), other.storage_.end(), storage_.begin());
+  }
+
+  // word-wise equality (no per neuron compare)
+  bool similar(const PackedPattern &other) const {
+    return std::equal(storage_.begin(), storage_.end(), other.storage_.begin());
+  }
+
+  // xor + popcount distance
+  size_t hamming(const PackedPattern &other) const {
+    size_t diff = 0;
+    for (size_t w = 0; w < storage_.size(); w++) {
+      diff += static_cast<size_t>(__builtin_popcountll(storage_[w] ^ other.storage_[w]));
+    }
+    return diff;
+  }
+
+  // expand back into a -1/1 vector
+  template<typename C=short>
+  Vector<C> unpack() const {
+    Vector<C> cp(num_rows());
+    for (size_t i = 0; i < num_rows(); i++) {
+      cp(i) = static_cast<C>(this->operator()(i));
+    }
+    return cp;
+  }
+
+  void print() {
+    std::cout << "[";
+    for (size_t i = 0; i < num_rows(); i++) {
+      std::cout << this->operator()(i) << ((i == (num_rows() - 1)) ? "" : " ");
+    }
+    std::cout << "]" << std::endl;
+  }
+
+        word_t* words()       { return storage_.data(); }
+  const word_t* words() const { return storage_.data(); }
+
+  size_t num_words() const { return storage_.size(); }
+  size_t num_rows() const { return num_rows_; }
+
+  static size_t words_for(size_t M) { return (M + WORD_BITS - 1) / WORD_BITS; }
+
+private:
+  static word_t bit(size_t i) { return word_t(1) << (i % WORD_BITS); }
+
+  // mask of the valid bits in the last word
+  word_t tail_mask() const {
+    size_t rem = num_rows_ % WORD_BITS;
+    return (rem == 0) ? ~word_t(0) : ((word_t(1) << rem) - 1);
+  }
+
+  size_t              num_rows_;
+  std::vector<word_t> storage_;
+};
+
+typedef PackedPattern packed_pattern_t;
+typedef std::vector<PackedPattern> packed_patterns_t;
+
+void make_random_patterns(const size_t neurons, packed_patterns_t &patts, const size_t num, Rng &rng = thread_rng());
+size_t transpose_patterns(const packed_patterns_t &patts, std::vector<PackedPattern::word_t> &bits);
+void make_hammed_patterns(const packed_pattern_t &orig, packed_patterns_t &patts, const size_t num, const size_t distance, bool incremental, Rng &rng = thread_rng());
+
+// the same draws written in place to patts[first, first + num) (patts is resized to first + num),
+// the patterns patts already holds are reused so a steady state caller does not allocate
+void fill_random_patterns(const size_t neurons, packed_patterns_t &patts, const size_t first, const size_t num, Rng &rng = thread_rng());
+void fill_hammed_patterns(const packed_pattern_t &orig, packed_patterns_t &patts, const size_t first, const size_t num, const size_t distance, Rng &rng = thread_rng());
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef PROPORTION_HPP
+#define PROPORTION_HPP
+
+#include <cstddef>
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include "matrix.hpp"
+#include "sparse.hpp"
+#include "vector.hpp"
+#include "packed.hpp"
+#include "random.hpp"
+#include "recall.hpp"
+#include "instrument.hpp"
+#include "arena.hpp"
+
+// general flag to see progress of network specifically
+// #define DEBUG
+
+// recall num_patterns patterns a hamming distance away from pattern on a trained network
+// and count how many of them retrieve the original pattern
+// (H is any network type with the Matrix training/recall interface, e.g. hopfield_t or sparse_hopfield_t,
+// it is only read so one trained network can be probed from many threads at once)
+template<typename H, typename P>
+int count_converged(const H &hopfield, const P &pattern, const size_t num_patterns, const size_t hamming, Rng &rng) {
+  #ifdef DEBUG
+    std::cout << "Creating " << num_patterns << " hammed patterns from original with radius " << hamming << std::endl;
+  #endif
+  // probes are the original with hamming neurons flipped each, kept as flip lists so the recall derives their
+  // fields from the original's instead of a product per probe (flips and recalled patterns live in the
+  // thread's scratch pool, no allocations once warm)
+  Scratch<size_t, SCRATCH_FLIP_LIST> flips_lease;
+  std::vector<size_t> &flips = *flips_lease;
+  {
+    INSTR_SCOPE(INSTR_PROBE_NS);
+    make_hammed_flips(pattern.num_rows(), flips, num_patterns, hamming, rng);
+    INSTR_COUNT(INSTR_PROBES, num_patterns);
+  }
+
+  // run all probes until they reach an energy minimum (batched so the weights are streamed once per sweep for many probes)
+  Scratch<P, SCRATCH_RETRIEVED> retrieved_lease;
+  std::vector<P> &retrieved_memories = *retrieved_lease;
+  {
+    INSTR_SCOPE(INSTR_RECALL_NS);
+    run_hammed_to_min(hopfield, pattern, flips, num_patterns, hamming, retrieved_memories, rng);
+  }
+
+  // keep track of proportions
+  int converged = 0.0;
+  for (P &retrieved_memory : retrieved_memories) {
+    // is the retrieved memory from the hopfield network similar to our hammed distance one?
+    if (retrieved_memory.similar(pattern)) {
+        converged++; // add one to converged
+    }
+  }
+
+  // return the proportion that have converged
+  return converged;
+}
+
+// largest hamming distance (up to max_hamming) at which converged(distance) still counts at least threshold
+// of num_patterns probes, found by bisection over the distance (assumes the count falls with distance,
+// evaluations counts the converged calls)
+template<typename Fn>
+size_t bisect_radius(Fn converged, const size_t num_patterns, const size_t max_hamming, const double threshold, size_t &evaluations) {
+  const int needed = static_cast<int>(std::ceil(threshold * static_cast<double>(num_patterns)));
+  evaluations = 1;
+
+  // an unstable original has no basin, and a basin can not reach past max_hamming
+  if (converged(0) < needed) return 0;
+  evaluations++;
+  if (converged(max_hamming) >= needed) return max_hamming;
+
+  // converged at lo, not at hi
+  size_t lo = 0, hi = max_hamming;
+  while (hi - lo > 1) {
+    const size_t mid = lo + (hi - lo) / 2;
+    evaluations++;
+    if (converged(mid) >= needed) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// critical radius of a trained network: the largest hamming distance (up to max_hamming) at which at least
+// threshold of num_patterns probes converge back to pattern (evaluations counts the count_converged calls)
+template<typename H, typename P>
+size_t basin_radius(const H &hopfield, const P &pattern, const size_t num_patterns, const size_t max_hamming, const double threshold, size_t &evaluations, Rng &rng) {
+  return bisect_radius([&](const size_t hamming) {
+    return count_converged(hopfield, pattern, num_patterns, hamming, rng);
+  }, num_patterns, max_hamming, threshold, evaluations);
+}
+
+// draw a random original pattern and train the network on it plus num_train_patterns more
+// (random ones, or ones train_hamming away from the original when train_hammed)
+template<typename P, typename H>
+void train_network(H &hopfield, P &pattern, const bool train_hammed, const size_t train_hamming, const size_t num_train_patterns, Rng &rng) {
+  // create the original pattern
+  #ifdef DEBUG
+    std::cout << "Creating random pattern" << std::endl;
+  #endif
+  const size_t neuron_size = hopfield.num_rows();
+  pattern.randomize(rng); // give 1/2 prob to each 1,-1
+
+  // container for all patterns (original pattern will be included in this, reused from the thread's scratch pool)
+  INSTR_SCOPE(INSTR_TRAIN_NS);
+  Scratch<P, SCRATCH_TRAIN> train_lease;
+  std::vector<P> &train_patterns = *train_lease;
+
+  // now create the mostly orthoginal (until a certain point) patterns that are all a certain hamming away
+  if (train_hammed) { // let's specify the hamming distance for our training patterns? would be interesting to see radius of convergence as ham distance changes
+    #ifdef DEBUG
+      std::cout << "Creating training patterns " << num_train_patterns << " patterns with radius " << train_hamming << " from original" << std::endl;
+    #endif
+    fill_hammed_patterns(pattern, train_patterns, 1, num_train_patterns, train_hamming, rng); // after the slot of the original
+  } else {
+    #ifdef DEBUG
+      std::cout << "Creating random training patterns " << num_train_patterns << std::endl;
+    #endif
+    // add random patterns to training
+    fill_random_patterns(neuron_size, train_patterns, 1, num_train_patterns, rng);
+  }
+
+  // add original pattern to training
+  train_patterns[0] = pattern;
+
+  // train a network on the specified patterns
+  #ifdef DEBUG
+    std::cout << "Training network" << std::endl;
+  #endif
+
+  // train the hopfield network
+  hopfield.zeroize();  // zeroize weights to prevent additional adding
+  hopfield.train_on(train_patterns);
+} // on exit train patterns go back to the scratch pool
+
+// pattern type P can be pattern_t (a short per neuron) or packed_pattern_t (a bit per neuron)
+template<typename P, typename H>
+int proportion_of_convergence(H &hopfield, const size_t num_patterns, const size_t hamming, const bool train_hammed, const size_t train_hamming, const size_t num_train_patterns, Rng &rng) {
+  // runs a simulation calculating the proportion of valus converging in parallel
+  P pattern(hopfield.num_rows());
+  train_network(hopfield, pattern, train_hammed, train_hamming, num_train_patterns, rng);
+
+  // test how many hammed patterns converge back to the original
+  return count_converged(hopfield, pattern, num_patterns, hamming, rng);
+}
+
+#endif
@@ -0,0 +1,266 @@
+#include "quantized.hpp"
+#include "recall.hpp"
+#include "arena.hpp"
+#include "util.hpp"
+#include <omp.h>
+#include <limits>
+#include <algorithm>
+
+// tile edge (in neurons) of the blocked integer hebbian kernel
+#define QUANT_HEBB_BLOCK 64
+
+// w_ij += sign * (x_i . x_j) with x_i . x_j = P - 2 * popcount(bits_i ^ bits_j) for i != j,
+// upper triangle tile by tile with each tile mirrored while still in cache (as Matrix::hebbian)
+template<typename T>
+void IntMatrix<T>::hebbian(const packed_patterns_t &patterns, const int sign) {
+  INSTR_COUNT(INSTR_TRAININGS, 1);
+  const size_t N = num_rows_;
+
+  Scratch<PackedPattern::word_t, SCRATCH_BITS> bits_lease;
+  std::vector<PackedPattern::word_t> &bits = *bits_lease;
+  const size_t pw = transpose_patterns(patterns, bits);
+  const long pattern_n = static_cast<long>(patterns.size());
+  const size_t nblocks = (N + QUANT_HEBB_BLOCK - 1) / QUANT_HEBB_BLOCK;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t bi = 0; bi < nblocks; bi++) {
+    const size_t i0 = bi * QUANT_HEBB_BLOCK;
+    const size_t i1 = std::min(N, i0 + QUANT_HEBB_BLOCK);
+
+    for (size_t bj = bi; bj < nblocks; bj++) {
+      const size_t j0 = bj * QUANT_HEBB_BLOCK;
+      const size_t j1 = std::min(N, j0 + QUANT_HEBB_BLOCK);
+
+      for (size_t i = i0; i < i1; i++) {
+        const PackedPattern::word_t *xi = &bits[i * pw];
+        T *row = &storage_[i * N];
+        const size_t js = std::max(j0, i + 1);
+
+        for (size_t j = js; j < j1; j++) {
+          const PackedPattern::word_t *xj = &bits[j * pw];
+          long diff = 0;
+          for (size_t w = 0; w < pw; w++) {
+            diff += __builtin_popcountll(xi[w] ^ xj[w]);
+          }
+          row[j] = static_cast<T>(static_cast<long>(row[j]) + sign * (pattern_n - 2 * diff));
+        }
+      }
+
+      // mirror the tile into the lower triangle
+      for (size_t j = j0; j < j1; j++) {
+        T *row = &storage_[j * N];
+        const size_t ie = std::min(i1, j);
+        for (size_t i = i0; i < ie; i++) {
+          row[i] = storage_[i * N + j];
+        }
+      }
+    }
+  }
+}
+
+size_t QuantMatrix::width_for(const size_t P) {
+  if (P <= static_cast<size_t>(std::numeric_limits<int8_t>::max())) return 1;
+  if (P <= static_cast<size_t>(std::numeric_limits<int16_t>::max())) return 2;
+  return 4;
+}
+
+void QuantMatrix::select(const size_t P) {
+  const size_t width = std::max(width_, width_for(P));
+  if (width == width_) return;
+
+  switch (width) {
+    case 1:
+      w8_.allocate();
+      break;
+    case 2:
+      if (width_ == 1) w16_.widen_from(w8_); else w16_.allocate();
+      w8_.release();
+      break;
+    default:
+      if (width_ == 1) w32_.widen_from(w8_); else if (width_ == 2) w32_.widen_from(w16_); else w32_.allocate();
+      w8_.release();
+      w16_.release();
+      break;
+  }
+  width_ = width;
+}
+
+double QuantMatrix::operator()(size_t i, size_t j) const {
+  if (num_patterns_ == 0) return 0.0;
+
+  double w = 0.0;
+  switch (width_) {
+    case 1:  w = w8_(i, j); break;
+    case 2:  w = w16_(i, j); break;
+    default: w = w32_(i, j); break;
+  }
+  return w / static_cast<double>(num_patterns_);
+}
+
+void QuantMatrix::zeroize() {
+  switch (width_) {
+    case 1:  w8_.zeroize(); break;
+    case 2:  w16_.zeroize(); break;
+    default: w32_.zeroize(); break;
+  }
+  num_patterns_ = 0;
+}
+
+void QuantMatrix::fields(const int32_t *x, int32_t *h) const {
+  switch (width_) {
+    case 1:  w8_.fields(x, h); break;
+    case 2:  w16_.fields(x, h); break;
+    default: w32_.fields(x, h); break;
+  }
+}
+
+void QuantMatrix::train_on(patterns_t &patterns) {
+  // pack into bits and use the popcount kernel
+  packed_patterns_t packed;
+  packed.reserve(patterns.size());
+  for (size_t p = 0; p < patterns.size(); ++p) {
+    packed.push_back(PackedPattern(patterns.at(p)));
+  }
+  train_on(packed);
+}
+
+// retraining starts over in the narrowest type for the new P
+void QuantMatrix::train_on(packed_patterns_t &patterns) {
+  w8_.release();
+  w16_.release();
+  w32_.release();
+  width_ = 0;
+  num_patterns_ = 0;
+  select(patterns.size());
+  add_patterns(patterns);
+}
+
+void QuantMatrix::add_pattern(const packed_pattern_t &pattern) {
+  add_patterns(packed_patterns_t(1, pattern));
+}
+
+void QuantMatrix::add_patterns(const packed_patterns_t &patterns) {
+  if (patterns.empty()) return;
+
+  select(num_patterns_ + patterns.size());
+  switch (width_) {
+    case 1:  w8_.hebbian(patterns, 1); break;
+    case 2:  w16_.hebbian(patterns, 1); break;
+    default: w32_.hebbian(patterns, 1); break;
+  }
+  num_patterns_ += patterns.size();
+}
+
+void QuantMatrix::remove_pattern(const packed_pattern_t &pattern) {
+  remove_patterns(packed_patterns_t(1, pattern));
+}
+
+// integer sums unlearn exactly (the storage keeps its width)
+void QuantMatrix::remove_patterns(const packed_patterns_t &patterns) {
+  if (patterns.empty()) return;
+  if (patterns.size() > num_patterns_) {
+    std::cerr << "Cannot remove " << patterns.size() << " patterns from a network trained on " << num_patterns_ << std::endl;
+    std::exit(1);
+  }
+
+  switch (width_) {
+    case 1:  w8_.hebbian(patterns, -1); break;
+    case 2:  w16_.hebbian(patterns, -1); break;
+    default: w32_.hebbian(patterns, -1); break;
+  }
+  num_patterns_ -= patterns.size();
+}
+
+template<typename P>
+size_t QuantMatrix::recall(const P &pattern, P &out_pattern, Rng &rng) const {
+  size_t steps = 0;
+  switch (width_) {
+    case 1: {
+      Recall<IntMatrix<int8_t>, int32_t> engine(w8_);
+      engine.load(pattern);
+      steps = engine.run(rng);
+      engine.store(out_pattern);
+      break;
+    }
+    case 2: {
+      Recall<IntMatrix<int16_t>, int32_t> engine(w16_);
+      engine.load(pattern);
+      steps = engine.run(rng);
+      engine.store(out_pattern);
+      break;
+    }
+    default: {
+      Recall<IntMatrix<int32_t>, int32_t> engine(w32_);
+      engine.load(pattern);
+      steps = engine.run(rng);
+      engine.store(out_pattern);
+      break;
+    }
+  }
+  return steps;
+}
+
+template<typename P>
+size_t QuantMatrix::batch_recall(const std::vector<P> &patterns, std::vector<P> &out_patterns, const bool synchronous, Rng &rng) const {
+  switch (width_) {
+    case 1: {
+      BatchRecall<IntMatrix<int8_t>, int32_t> engine(w8_);
+      return engine.run(patterns, out_patterns, synchronous, rng);
+    }
+    case 2: {
+      BatchRecall<IntMatrix<int16_t>, int32_t> engine(w16_);
+      return engine.run(patterns, out_patterns, synchronous, rng);
+    }
+    default: {
+      BatchRecall<IntMatrix<int32_t>, int32_t> engine(w32_);
+      return engine.run(patterns, out_patterns, synchronous, rng);
+    }
+  }
+}
+
+template<typename P>
+size_t QuantMatrix::hammed_recall(const P &base, const std::vector<size_t> &flips, const size_t num, const size_t distance, std::vector<P> &out_patterns, Rng &rng) const {
+  switch (width_) {
+    case 1: {
+      BatchRecall<IntMatrix<int8_t>, int32_t> engine(w8_);
+      return engine.run_hammed(base, flips.data(), num, distance, out_patterns, rng);
+    }
+    case 2: {
+      BatchRecall<IntMatrix<int16_t>, int32_t> engine(w16_);
+      return engine.run_hammed(base, flips.data(), num, distance, out_patterns, rng);
+    }
+    default: {
+      BatchRecall<IntMatrix<int32_t>, int32_t> engine(w32_);
+      return engine.run_hammed(base, flips.data(), num, distance, out_patterns, rng);
+    }
+  }
+}
+
+size_t QuantMatrix::run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng) const {
+  return recall(pattern, out_pattern, rng);
+}
+
+size_t QuantMatrix::run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng) const {
+  return recall(pattern, out_pattern, rng);
+}
+
+size_t QuantMatrix::run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  return batch_recall(patterns, out_patterns, synchronous, rng);
+}
+
+size_t QuantMatrix::run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  return batch_recall(patterns, out_patterns, synchronous, rng);
+}
+
+size_t QuantMatrix::run_hammed_to_min(const pattern_t &base, const std::vector<size_t> &flips, const size_t num, const size_t distance, patterns_t &out_patterns, Rng &rng) const {
+  return hammed_recall(base, flips, num, distance, out_patterns, rng);
+}
+
+size_t QuantMatrix::run_hammed_to_min(const packed_pattern_t &base, const std::vector<size_t> &flips, const size_t num, const size_t distance, packed_patterns_t &out_patterns, Rng &rng) const {
+  return hammed_recall(base, flips, num, distance, out_patterns, rng);
+}
+
+// force declarations of the following templates
+template class IntMatrix<int8_t>;
+template class IntMatrix<int16_t>;
+template class IntMatrix<int32_t>;
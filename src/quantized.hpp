@@ -0,0 +1,212 @@
+#ifndef QUANTIZED_HPP
+#define QUANTIZED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include "vector.hpp"
+#include "packed.hpp"
+#include "random.hpp"
+#include "instrument.hpp"
+#include "util.hpp"
+
+// Hebbian weights before the divide by P, w_ij = sum_p x_i x_j is an exact integer in [-P, P]
+// and the sign threshold of recall does not depend on the positive 1/P, so recall on these
+// integers (with integer fields) flips exactly the neurons the double path flips.
+// (the double path treats |h| <= EPS as a tie, nonzero integer fields are at least 1/P there,
+// so both agree while P < 1 / EPS)
+template<typename T>
+class IntMatrix {
+public:
+  IntMatrix(size_t N) : num_rows_(N) {}
+
+  void allocate() { storage_.assign(num_rows_ * num_rows_, 0); }
+  void release() { std::vector<T>().swap(storage_); }
+  void zeroize() { std::fill(storage_.begin(), storage_.end(), static_cast<T>(0)); }
+
+  // copy the (narrower) weights of another integer matrix
+  template<typename S>
+  void widen_from(const IntMatrix<S> &other) {
+    storage_.resize(other.storage().size());
+    std::copy(other.storage().begin(), other.storage().end(), storage_.begin());
+  }
+
+  T operator()(size_t i, size_t j) const { return storage_[i * num_rows_ + j]; }
+
+  // local fields h = W x, the narrow weights are widened into F in the multiply-add
+  template<typename F>
+  void fields(const F *x, F *h) const {
+    for (size_t i = 0; i < num_rows_; i++) {
+      const T *row = &storage_[i * num_rows_];
+      F hoist = 0;
+
+      #pragma omp simd reduction(+:hoist)
+      for (size_t j = 0; j < num_rows_; j++) {
+        hoist += static_cast<F>(row[j]) * x[j];
+      }
+      h[i] = hoist;
+    }
+  }
+
+  // fields of a batch of probes h[b * ld + i] (each weight row is reused for 4 probes)
+  template<typename F>
+  void fields_batch(const F *x, F *h, const size_t count, const size_t ld) const {
+    size_t b = 0;
+    for (; b + 4 <= count; b += 4) {
+      const F *x0 = x + b * ld, *x1 = x0 + ld, *x2 = x1 + ld, *x3 = x2 + ld;
+      for (size_t i = 0; i < num_rows_; i++) {
+        const T *row = &storage_[i * num_rows_];
+        F a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+
+        #pragma omp simd reduction(+:a0,a1,a2,a3)
+        for (size_t j = 0; j < num_rows_; j++) {
+          const F w = static_cast<F>(row[j]);
+          a0 += w * x0[j];
+          a1 += w * x1[j];
+          a2 += w * x2[j];
+          a3 += w * x3[j];
+        }
+        h[b * ld + i] = a0;
+        h[(b + 1) * ld + i] = a1;
+        h[(b + 2) * ld + i] = a2;
+        h[(b + 3) * ld + i] = a3;
+      }
+    }
+
+    for (; b < count; b++) {
+      fields(x + b * ld, h + b * ld);
+    }
+  }
+
+  // h += scale * W[:, k] (symmetric so the column is row k)
+  template<typename F>
+  void add_column(size_t k, const F &scale, F *h) const {
+    const T *row = &storage_[k * num_rows_];
+
+    #pragma omp simd
+    for (size_t j = 0; j < num_rows_; j++) {
+      h[j] += scale * static_cast<F>(row[j]);
+    }
+  }
+
+  // sum_ij w_ij s_i s_j (exact)
+  template<typename P>
+  int64_t quadratic(const P &pattern) const {
+    std::vector<int32_t> s(num_rows_);
+    for (size_t i = 0; i < num_rows_; i++) {
+      s[i] = static_cast<int32_t>(pattern(i));
+    }
+
+    int64_t q = 0;
+    for (size_t i = 0; i < num_rows_; i++) {
+      const T *row = &storage_[i * num_rows_];
+      int64_t hoist = 0;
+
+      #pragma omp simd reduction(+:hoist)
+      for (size_t j = 0; j < num_rows_; j++) {
+        hoist += static_cast<int64_t>(row[j]) * s[j];
+      }
+      q += hoist * s[i];
+    }
+    return q;
+  }
+
+  void hebbian(const packed_patterns_t &patterns, const int sign);
+
+  size_t num_rows() const { return num_rows_; }
+  const std::vector<T> &storage() const { return storage_; }
+
+private:
+  size_t         num_rows_;
+  std::vector<T> storage_;
+};
+
+// fully connected network with integer weights stored in the narrowest of
+// int8/int16/int32 that holds [-P, P] (widened in place as patterns are added),
+// recall runs with integer states and fields. Same interface as Matrix
+class QuantMatrix {
+public:
+  QuantMatrix(size_t N) : num_rows_(N), num_patterns_(0), width_(0), w8_(N), w16_(N), w32_(N) { select(0); }
+
+  // same shape arguments as Matrix so it can stand in for hopfield_t
+  QuantMatrix(size_t N, size_t M) : QuantMatrix(N) {
+    if (N != M) {
+      std::cerr << "Quantized weights must be square, got " << N << "x" << M << std::endl;
+      std::exit(1);
+    }
+  }
+
+  // weight as the double path stores it (w_ij / P)
+  double operator()(size_t i, size_t j) const;
+  void zeroize();
+
+  // E = -1/2 sum_ij (w_ij / P) s_i s_j
+  template<typename P>
+  double energy(const P &pattern) const {
+    INSTR_COUNT(INSTR_ENERGY_EVALS, 1);
+    if (num_patterns_ == 0) return 0.0;
+
+    int64_t q = 0;
+    switch (width_) {
+      case 1:  q = w8_.quadratic(pattern); break;
+      case 2:  q = w16_.quadratic(pattern); break;
+      default: q = w32_.quadratic(pattern); break;
+    }
+    return -0.5 * static_cast<double>(q) / static_cast<double>(num_patterns_);
+  }
+
+  // integer local fields h = W x (P times the double fields)
+  void fields(const int32_t *x, int32_t *h) const;
+
+  void train_on(patterns_t &patterns);
+  void train_on(packed_patterns_t &patterns);
+  void add_pattern(const packed_pattern_t &pattern);
+  void add_patterns(const packed_patterns_t &patterns);
+  void remove_pattern(const packed_pattern_t &pattern);
+  void remove_patterns(const packed_patterns_t &patterns);
+
+  size_t run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+  size_t run_hammed_to_min(const pattern_t &base, const std::vector<size_t> &flips, const size_t num, const size_t distance, patterns_t &out_patterns, Rng &rng = thread_rng()) const;
+  size_t run_hammed_to_min(const packed_pattern_t &base, const std::vector<size_t> &flips, const size_t num, const size_t distance, packed_patterns_t &out_patterns, Rng &rng = thread_rng()) const;
+
+  size_t num_rows() const { return num_rows_; }
+  size_t num_cols() const { return num_rows_; }
+  size_t num_patterns() const { return num_patterns_; }
+  size_t width() const { return width_; }  // bytes per weight
+
+  // bytes per weight needed for weights in [-P, P]
+  static size_t width_for(const size_t P);
+
+private:
+  void select(const size_t P);  // widen (keeping the weights) until P fits
+
+  template<typename P>
+  size_t recall(const P &pattern, P &out_pattern, Rng &rng) const;
+  template<typename P>
+  size_t batch_recall(const std::vector<P> &patterns, std::vector<P> &out_patterns, const bool synchronous, Rng &rng) const;
+  template<typename P>
+  size_t hammed_recall(const P &base, const std::vector<size_t> &flips, const size_t num, const size_t distance, std::vector<P> &out_patterns, Rng &rng) const;
+
+  size_t              num_rows_;
+  size_t              num_patterns_;
+  size_t              width_;
+  IntMatrix<int8_t>   w8_;
+  IntMatrix<int16_t>  w16_;
+  IntMatrix<int32_t>  w32_;
+};
+
+typedef QuantMatrix quant_hopfield_t;
+
+// hammed probes keep the width switch of the member (more specialized than the generic one in recall.hpp)
+template<typename P>
+size_t run_hammed_to_min(const QuantMatrix &weights, const P &base, const std::vector<size_t> &flips, const size_t num, const size_t distance, std::vector<P> &out_patterns, Rng &rng = thread_rng()) {
+  return weights.run_hammed_to_min(base, flips, num, distance, out_patterns, rng);
+}
+
+#endif
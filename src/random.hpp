@@ -0,0 +1,120 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <omp.h>
+
+#define RNG_GOLDEN 0x9e3779b97f4a7c15ULL // weyl increment of splitmix64
+
+// splitmix64 finalizer (bijective 64-bit mix)
+inline uint64_t mix64(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// counter-based generator: the i-th output of a stream is mix64(key + (i + 1) * golden)
+// so state is a 16 byte (key, counter) pair, any position can be jumped to directly
+// and independent streams are split off by key (a task keys its stream by what it
+// computes instead of which thread runs it, which keeps runs reproducible from a
+// single master seed for any thread count)
+class Rng {
+public:
+  typedef uint64_t result_type;
+
+  explicit Rng(uint64_t seed=0, uint64_t stream=0) : key_(mix64(seed ^ mix64(stream * RNG_GOLDEN + 1))), counter_(0) {}
+
+  // independent child stream (split(a).split(b) differs from split(b).split(a))
+  Rng split(uint64_t stream) const {
+    Rng child;
+    child.key_ = mix64(key_ ^ mix64((stream + 1) * RNG_GOLDEN));
+    return child;
+  }
+
+  uint64_t at(uint64_t counter) const { return mix64(key_ + (counter + 1) * RNG_GOLDEN); }
+  uint64_t operator()() { return at(counter_++); }
+
+  // bulk generation (every output is independent of the others so this vectorizes)
+  void fill(uint64_t *out, size_t num) {
+    const uint64_t key = key_;
+    const uint64_t start = counter_;
+
+    #pragma omp simd
+    for (size_t i = 0; i < num; i++) {
+      out[i] = mix64(key + (start + i + 1) * RNG_GOLDEN);
+    }
+    counter_ += num;
+  }
+
+  // uniform double in [0, 1)
+  double uniform() { return static_cast<double>(this->operator()() >> 11) * (1.0 / 9007199254740992.0); }
+  double uniform(const double &from, const double &to) { return from + (to - from) * uniform(); }
+
+  // uniform integer in [0, range) (lemire's multiply and reject)
+  uint64_t bounded(uint64_t range) {
+    unsigned __int128 m = static_cast<unsigned __int128>(this->operator()()) * range;
+    uint64_t low = static_cast<uint64_t>(m);
+    if (low < range) {
+      const uint64_t threshold = -range % range;
+      while (low < threshold) {
+        m = static_cast<unsigned __int128>(this->operator()()) * range;
+        low = static_cast<uint64_t>(m);
+      }
+    }
+    return static_cast<uint64_t>(m >> 64);
+  }
+
+  // fisher-yates shuffle (portable unlike std::shuffle whose draws are implementation defined)
+  template<typename It>
+  void shuffle(It first, It last) {
+    partial_shuffle(first, last, static_cast<size_t>(last - first));
+  }
+
+  // only the first count elements are drawn (a uniform sample without replacement)
+  template<typename It>
+  void partial_shuffle(It first, It last, size_t count) {
+    const size_t n = static_cast<size_t>(last - first);
+    count = (count < n) ? count : n;
+    for (size_t i = 0; i < count && i + 1 < n; i++) {
+      const size_t j = i + static_cast<size_t>(bounded(n - i));
+      std::swap(first[i], first[j]);
+    }
+  }
+
+  uint64_t key() const { return key_; }
+  uint64_t position() const { return counter_; }
+  void seek(uint64_t counter) { counter_ = counter; }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~result_type(0); }
+
+private:
+  uint64_t key_;
+  uint64_t counter_;
+};
+
+// master seed every task stream is derived from
+inline uint64_t &master_seed() {
+  static uint64_t seed = 0x5eed;
+  return seed;
+}
+
+inline void set_master_seed(uint64_t seed) {
+  master_seed() = seed;
+}
+
+inline uint64_t random_seed() {
+  std::random_device rand_dev;
+  return (static_cast<uint64_t>(rand_dev()) << 32) ^ static_cast<uint64_t>(rand_dev());
+}
+
+// fallback stream for calls that are not handed one (reproducible only for a fixed thread count)
+inline Rng &thread_rng() {
+  static thread_local Rng rng(master_seed(), 0xffffffff00000000ULL + static_cast<uint64_t>(omp_get_thread_num()));
+  return rng;
+}
+
+#endif
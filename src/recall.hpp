@@ -0,0 +1,405 @@
+#ifndef RECALL_HPP
+#define RECALL_HPP
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include "vector.hpp"
+#include "random.hpp"
+#include "instrument.hpp"
+#include "util.hpp"
+#include "arena.hpp"
+
+// number of probes advanced together by the batch engine
+#define RECALL_BATCH 32
+
+// h = W s straight from the pattern when W has a kernel for its type (e.g. packed bipolar
+// states), otherwise from the states of the pattern already loaded into s
+template<typename W, typename P, typename F>
+auto recall_fields(const W &weights, const P &pattern, const F *, F *h, int) -> decltype(weights.fields(pattern, h), void()) {
+  weights.fields(pattern, h);
+}
+
+template<typename W, typename P, typename F>
+void recall_fields(const W &weights, const P &, const F *s, F *h, long) {
+  weights.fields(s, h);
+}
+
+// asynchronous recall engine that keeps the local fields h = W s resident
+// W is any symmetric zero-diagonal weight container providing
+//   num_rows()
+//   fields(const F *s, F *h)             h = W s
+//   add_column(size_t k, F scale, F *h)  h += scale * W[:, k]
+// so a flip only costs a single column update and the energy is tracked from h
+// (its buffers are borrowed from the thread's scratch pool, see arena.hpp)
+template<typename W, typename F=double>
+class Recall {
+public:
+  Recall(const W &weights) : weights_(weights), energy_(0.0) {
+    const size_t N = weights.num_rows();
+    scratch_take<SCRATCH_STATE>(state_, N);
+    scratch_take<SCRATCH_FIELDS>(fields_, N);
+    scratch_take<SCRATCH_ORDER>(indx_, N);
+    for (size_t i = 0; i < indx_.size(); i++) {
+      indx_[i] = i;
+    }
+  }
+
+  ~Recall() {
+    scratch_return<SCRATCH_STATE>(state_);
+    scratch_return<SCRATCH_FIELDS>(fields_);
+    scratch_return<SCRATCH_ORDER>(indx_);
+  }
+
+  Recall(const Recall &) = delete;
+  Recall &operator=(const Recall &) = delete;
+
+  // load a starting -1/1 pattern and compute its fields (the only O(N^2) step)
+  template<typename P>
+  void load(const P &pattern) {
+    for (size_t i = 0; i < state_.size(); i++) {
+      state_[i] = static_cast<F>(pattern(i));
+    }
+    recall_fields(weights_, pattern, state_.data(), fields_.data(), 0);
+    INSTR_COUNT(INSTR_MATVECS, 1);
+
+    // E = -1/2 sum_i s_i h_i
+    double e = 0.0;
+    for (size_t i = 0; i < state_.size(); i++) {
+      e -= static_cast<double>(state_[i]) * static_cast<double>(fields_[i]);
+    }
+    energy_ = 0.5 * e;
+  }
+
+  // start from the pattern loaded into base (an engine on the same weights) with the neurons
+  // flips[0, d) flipped, fields and energy follow from d column updates, O(N d) instead of O(N^2)
+  void load_flipped(const Recall &base, const size_t *flips, const size_t d) {
+    std::copy(base.state_.begin(), base.state_.end(), state_.begin());
+    std::copy(base.fields_.begin(), base.fields_.end(), fields_.begin());
+    energy_ = base.energy_;
+    for (size_t k = 0; k < d; k++) {
+      flip(flips[k]);
+    }
+  }
+
+  // flip neuron k keeping fields and energy in sync
+  void flip(size_t k) {
+    const F old = state_[k];
+    energy_ += 2.0 * static_cast<double>(old) * static_cast<double>(fields_[k]); // dE = 2 s_k h_k (w_kk = 0)
+    weights_.add_column(k, static_cast<F>(-2) * old, fields_.data());  // dh = W[:, k] * (s_new - s_old)
+    state_[k] = -old;
+  }
+
+  // one asynchronous pass in a random order, returns the number of flips
+  size_t sweep(Rng &rng) {
+    rng.shuffle(indx_.begin(), indx_.end());
+
+    size_t flips = 0;
+    for (size_t i = 0; i < indx_.size(); i++) {
+      size_t ind = indx_[i];
+      const F h = fields_[ind];
+      if (dcompare(h, static_cast<F>(0))) {
+        continue; // no field keeps the previous state
+      }
+
+      // apply threshold and only touch the fields when the sign changes
+      const F nvalue = (h > 0) ? static_cast<F>(1) : static_cast<F>(-1);
+      if (nvalue != state_[ind]) {
+        flip(ind);
+        flips++;
+      }
+    }
+    return flips;
+  }
+
+  // sweep until a full pass flips nothing (a fixed point), returns the number of sweeps
+  size_t run(Rng &rng) {
+    size_t steps = 0;
+    while (true) {
+      steps++;
+      size_t flips = sweep(rng);
+      INSTR_COUNT(INSTR_SWEEPS, 1);
+      INSTR_COUNT(INSTR_FLIPS, flips);
+      if (flips == 0) {
+        break;
+      }
+    }
+    return steps;
+  }
+
+  // copy the state out to any pattern type with set-able -1/1 entries
+  template<typename P>
+  void store(P &out) const {
+    for (size_t i = 0; i < state_.size(); i++) {
+      set_state(out, i, static_cast<short>(state_[i]));
+    }
+  }
+
+  double energy() const { return energy_; }
+  const F *fields() const { return fields_.data(); }
+  const F *state() const { return state_.data(); }
+  size_t num_rows() const { return state_.size(); }
+
+private:
+  template<typename P>
+  static void set_state(P &out, size_t i, short val) { out.set(i, val); }
+
+  template<typename C>
+  static void set_state(Vector<C> &out, size_t i, short val) { out(i) = static_cast<C>(val); }
+
+  const W             &weights_;
+  std::vector<F>      state_;
+  std::vector<F>      fields_;
+  std::vector<size_t> indx_;
+  double              energy_;
+};
+
+// batched recall that advances up to RECALL_BATCH probes together as a
+// probe-major state matrix (row b holds the N states of probe b)
+//   synchronous: every sweep recomputes all fields with one matrix-matrix
+//                product (fields_batch) and updates every neuron at once,
+//                a probe retires at a fixed point or a 2-cycle
+//   lockstep:    fields come from one matrix-matrix product and are then kept
+//                resident, every probe visits the neurons in its own random
+//                order (drawn from its own stream, so the probes stay
+//                independent samples as with one Recall per probe) and a
+//                probe retires after a sweep without flips
+// W additionally has to provide fields_batch(const F *x, F *h, count, ld)
+template<typename W, typename F=double>
+class BatchRecall {
+public:
+  BatchRecall(const W &weights, const size_t batch=RECALL_BATCH) : weights_(weights), neurons_(weights.num_rows()), batch_(batch), active_(0) {
+    const size_t N = neurons_;
+    scratch_take<SCRATCH_STATE>(state_, batch * N);
+    scratch_take<SCRATCH_FIELDS>(fields_, batch * N);
+    scratch_take<SCRATCH_PREV>(prev_, batch * N);
+    scratch_take<SCRATCH_FLIPS>(flips_, batch);
+    scratch_take<SCRATCH_SLOT>(slot_, batch);
+    scratch_take<SCRATCH_ORDER>(indx_, batch * N);
+    scratch_take<SCRATCH_STREAMS>(rngs_, batch);
+  }
+
+  ~BatchRecall() {
+    scratch_return<SCRATCH_STATE>(state_);
+    scratch_return<SCRATCH_FIELDS>(fields_);
+    scratch_return<SCRATCH_PREV>(prev_);
+    scratch_return<SCRATCH_FLIPS>(flips_);
+    scratch_return<SCRATCH_SLOT>(slot_);
+    scratch_return<SCRATCH_ORDER>(indx_);
+    scratch_return<SCRATCH_STREAMS>(rngs_);
+  }
+
+  BatchRecall(const BatchRecall &) = delete;
+  BatchRecall &operator=(const BatchRecall &) = delete;
+
+  // recall every probe into out (resized to match, patterns it already holds are reused),
+  // returns the number of batch sweeps
+  template<typename P>
+  size_t run(const std::vector<P> &probes, std::vector<P> &out, const bool synchronous, Rng &rng) {
+    const size_t N = neurons_;
+    size_patterns(out, probes.size(), N);
+
+    size_t steps = 0;
+    for (size_t start = 0; start < probes.size(); start += batch_) {
+      active_ = std::min(batch_, probes.size() - start);
+      for (size_t b = 0; b < active_; b++) {
+        for (size_t i = 0; i < N; i++) {
+          state_[b * N + i] = static_cast<F>(probes[start + b](i));
+        }
+        start_probe(b, start + b, rng);
+      }
+
+      if (synchronous) {
+        steps += run_synchronous(out);
+      } else {
+        weights_.fields_batch(state_.data(), fields_.data(), active_, N);
+        INSTR_COUNT(INSTR_MATVECS, active_);
+        steps += run_lockstep(out);
+      }
+    }
+    return steps;
+  }
+
+  // recall num probes given as base with the neurons flips[b * distance, (b + 1) * distance) of
+  // probe b flipped (lockstep, every probe in its own order). The fields of base are computed once and
+  // every probe starts from them with distance column updates h += -2 s_k W[:, k], O(N distance)
+  // instead of O(N^2) per probe
+  template<typename P>
+  size_t run_hammed(const P &base, const size_t *flips, const size_t num, const size_t distance, std::vector<P> &out, Rng &rng) {
+    const size_t N = neurons_;
+    size_patterns(out, num, N);
+
+    Scratch<F, SCRATCH_BASE_STATE> state_lease;
+    Scratch<F, SCRATCH_BASE_FIELDS> fields_lease;
+    std::vector<F> &base_state = *state_lease;
+    std::vector<F> &base_fields = *fields_lease;
+    base_state.resize(N);
+    base_fields.resize(N);
+    for (size_t i = 0; i < N; i++) {
+      base_state[i] = static_cast<F>(base(i));
+    }
+    recall_fields(weights_, base, base_state.data(), base_fields.data(), 0);
+    INSTR_COUNT(INSTR_MATVECS, 1);
+
+    size_t steps = 0;
+    for (size_t start = 0; start < num; start += batch_) {
+      active_ = std::min(batch_, num - start);
+      for (size_t b = 0; b < active_; b++) {
+        F *s = &state_[b * N];
+        F *h = &fields_[b * N];
+        std::copy(base_state.begin(), base_state.end(), s);
+        std::copy(base_fields.begin(), base_fields.end(), h);
+
+        const size_t *f = flips + (start + b) * distance;
+        for (size_t k = 0; k < distance; k++) {
+          weights_.add_column(f[k], static_cast<F>(-2) * s[f[k]], h);
+          s[f[k]] = -s[f[k]];
+        }
+        start_probe(b, start + b, rng);
+      }
+
+      steps += run_lockstep(out);
+    }
+    return steps;
+  }
+
+private:
+  // probe b of the batch is probe slot of the output, it gets a stream of its own split off rng
+  // (the order it visits the neurons in is drawn from that stream only)
+  void start_probe(const size_t b, const size_t slot, Rng &rng) {
+    const size_t N = neurons_;
+    slot_[b] = slot;
+    rngs_[b] = rng.split(rng());
+    for (size_t i = 0; i < N; i++) {
+      indx_[b * N + i] = i;
+    }
+  }
+
+  // (fields of the active probes already loaded)
+  template<typename P>
+  size_t run_lockstep(std::vector<P> &out) {
+    const size_t N = neurons_;
+
+    size_t steps = 0;
+    while (active_ > 0) {
+      steps++;
+      INSTR_COUNT(INSTR_SWEEPS, active_);
+      for (size_t b = 0; b < active_; b++) {
+        rngs_[b].shuffle(indx_.begin() + b * N, indx_.begin() + (b + 1) * N);
+      }
+      std::fill(flips_.begin(), flips_.begin() + active_, 0);
+
+      for (size_t i = 0; i < N; i++) {
+        for (size_t b = 0; b < active_; b++) {
+          const size_t ind = indx_[b * N + i];
+          const F h = fields_[b * N + ind];
+          if (dcompare(h, static_cast<F>(0))) {
+            continue; // no field keeps the previous state
+          }
+
+          const F nvalue = (h > 0) ? static_cast<F>(1) : static_cast<F>(-1);
+          F &s = state_[b * N + ind];
+          if (nvalue != s) {
+            weights_.add_column(ind, static_cast<F>(-2) * s, &fields_[b * N]);
+            s = nvalue;
+            flips_[b]++;
+            INSTR_COUNT(INSTR_FLIPS, 1);
+          }
+        }
+      }
+
+      // retire the probes that reached a fixed point
+      for (size_t b = active_; b-- > 0;) {
+        if (flips_[b] == 0) {
+          retire(b, out);
+        }
+      }
+    }
+    return steps;
+  }
+
+  template<typename P>
+  size_t run_synchronous(std::vector<P> &out) {
+    const size_t N = neurons_;
+    std::copy(state_.begin(), state_.begin() + active_ * N, prev_.begin());
+
+    size_t steps = 0;
+    while (active_ > 0) {
+      steps++;
+      weights_.fields_batch(state_.data(), fields_.data(), active_, N);
+      INSTR_COUNT(INSTR_MATVECS, active_);
+      INSTR_COUNT(INSTR_SWEEPS, active_);
+
+      for (size_t b = active_; b-- > 0;) {
+        bool changed = false;
+        bool cycle = true;
+        for (size_t i = 0; i < N; i++) {
+          const F h = fields_[b * N + i];
+          F &s = state_[b * N + i];
+          F &p = prev_[b * N + i];
+          const F nvalue = dcompare(h, static_cast<F>(0)) ? s : ((h > 0) ? static_cast<F>(1) : static_cast<F>(-1));
+          if (nvalue != s) {
+            changed = true;
+            INSTR_COUNT(INSTR_FLIPS, 1);
+          }
+          cycle = cycle && (nvalue == p);
+          p = s;
+          s = nvalue;
+        }
+
+        // synchronous updates end in a fixed point or a 2-cycle
+        if (!changed || cycle) {
+          retire(b, out);
+        }
+      }
+    }
+    return steps;
+  }
+
+  // write out probe b and move the last active probe into its slot
+  template<typename P>
+  void retire(const size_t b, std::vector<P> &out) {
+    const size_t N = neurons_;
+    P &dest = out[slot_[b]];
+    for (size_t i = 0; i < N; i++) {
+      set_state(dest, i, static_cast<short>(state_[b * N + i]));
+    }
+
+    const size_t last = --active_;
+    if (b != last) {
+      std::copy(state_.begin() + last * N, state_.begin() + (last + 1) * N, state_.begin() + b * N);
+      std::copy(fields_.begin() + last * N, fields_.begin() + (last + 1) * N, fields_.begin() + b * N);
+      std::copy(prev_.begin() + last * N, prev_.begin() + (last + 1) * N, prev_.begin() + b * N);
+      std::copy(indx_.begin() + last * N, indx_.begin() + (last + 1) * N, indx_.begin() + b * N);
+      flips_[b] = flips_[last];
+      slot_[b] = slot_[last];
+      rngs_[b] = rngs_[last];
+    }
+  }
+
+  template<typename P>
+  static void set_state(P &out, size_t i, short val) { out.set(i, val); }
+
+  template<typename C>
+  static void set_state(Vector<C> &out, size_t i, short val) { out(i) = static_cast<C>(val); }
+
+  const W             &weights_;
+  size_t              neurons_, batch_, active_;
+  std::vector<F>      state_;
+  std::vector<F>      fields_;
+  std::vector<F>      prev_;
+  std::vector<size_t> flips_;
+  std::vector<size_t> slot_;
+  std::vector<size_t> indx_;
+  std::vector<Rng>    rngs_;
+};
+
+// recall probes given as a base pattern plus the neurons each one flips (see BatchRecall::run_hammed) on
+// any weights with the interface above, returns the number of batch sweeps
+template<typename W, typename P>
+size_t run_hammed_to_min(const W &weights, const P &base, const std::vector<size_t> &flips, const size_t num, const size_t distance, std::vector<P> &out_patterns, Rng &rng = thread_rng()) {
+  BatchRecall<W> recall(weights);
+  return recall.run_hammed(base, flips.data(), num, distance, out_patterns, rng);
+}
+
+#endif
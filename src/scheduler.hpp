@@ -0,0 +1,103 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <omp.h>
+
+// work-stealing scheduler run by the OpenMP thread team
+// every thread owns a deque: it pushes and pops its own work at the back (newest first)
+// and when it runs dry it steals the oldest task from the front of another deque.
+// tasks may push more tasks while running, run() returns once every task has finished
+template<typename Task>
+class Scheduler {
+public:
+  Scheduler() : threads_(static_cast<size_t>(omp_get_max_threads())), next_(0), pending_(0) {
+    for (size_t t = 0; t < threads_; t++) {
+      workers_.emplace_back(new Worker());
+    }
+  }
+
+  // queue a task (from outside run() they are dealt round robin, inside run() onto the caller's deque)
+  void push(const Task &task) {
+    size_t owner = omp_in_parallel() ? static_cast<size_t>(omp_get_thread_num()) : (next_++ % threads_);
+    pending_.fetch_add(1);
+
+    Worker &worker = *workers_[owner];
+    std::lock_guard<std::mutex> guard(worker.lock);
+    worker.tasks.push_back(task);
+  }
+
+  // run fn(task) on every task until none are left
+  template<typename Fn>
+  void run(Fn fn) {
+    #pragma omp parallel num_threads(static_cast<int>(threads_))
+    {
+      const size_t self = static_cast<size_t>(omp_get_thread_num());
+      uint64_t victim_state = self + 1;
+      Task task;
+
+      while (pending_.load() > 0) {
+        if (pop(self, task) || steal(self, victim_state, task)) {
+          fn(task);
+          pending_.fetch_sub(1);
+        } else {
+          std::this_thread::yield();  // everything left is running on other threads
+        }
+      }
+    }
+  }
+
+  size_t num_threads() const { return threads_; }
+
+private:
+  struct Worker {
+    std::mutex      lock;
+    std::deque<Task> tasks;
+    char            pad[64];  // keep neighbouring locks off the same cache line
+  };
+
+  bool pop(const size_t self, Task &task) {
+    Worker &worker = *workers_[self];
+    std::lock_guard<std::mutex> guard(worker.lock);
+    if (worker.tasks.empty()) return false;
+    task = worker.tasks.back();
+    worker.tasks.pop_back();
+    return true;
+  }
+
+  // scan the other deques starting from a random victim
+  bool steal(const size_t self, uint64_t &victim_state, Task &task) {
+    victim_state ^= victim_state << 13;
+    victim_state ^= victim_state >> 7;
+    victim_state ^= victim_state << 17;
+
+    const size_t start = static_cast<size_t>(victim_state % threads_);
+    for (size_t k = 0; k < threads_; k++) {
+      const size_t victim = (start + k) % threads_;
+      if (victim == self) continue;
+
+      Worker &worker = *workers_[victim];
+      std::lock_guard<std::mutex> guard(worker.lock);
+      if (!worker.tasks.empty()) {
+        task = worker.tasks.front();
+        worker.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t                               threads_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t>                  next_;
+  std::atomic<size_t>                  pending_;
+};
+
+#endif
@@ -0,0 +1,295 @@
+#include "sink.hpp"
+#include <iostream>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+static void sink_error(const std::string &path, const std::string &what) {
+  std::cerr << "Cannot write " << path << ": " << what << " (" << std::strerror(errno) << ")" << std::endl;
+  std::exit(1);
+}
+
+static int open_output(const std::string &path) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    sink_error(path, "open failed");
+  }
+  return fd;
+}
+
+// write all of buf (write may take less than asked for) and empty it
+static void write_all(const int fd, const std::string &path, std::string &buf) {
+  size_t done = 0;
+  while (done < buf.size()) {
+    ssize_t n = write(fd, buf.data() + done, buf.size() - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      sink_error(path, "write failed");
+    }
+    done += static_cast<size_t>(n);
+  }
+  buf.clear();
+}
+
+// numbers are printed as an ostream with default flags would (%g with 6 significant digits)
+static void append_uint(std::string &out, const uint64_t value) {
+  char num[32];
+  int len = std::snprintf(num, sizeof(num), "%llu,", static_cast<unsigned long long>(value));
+  out.append(num, static_cast<size_t>(len));
+}
+
+static void append_double(std::string &out, const double value, const char end) {
+  char num[32];
+  int len = std::snprintf(num, sizeof(num), "%g%c", value, end);
+  out.append(num, static_cast<size_t>(len));
+}
+
+// the .npy dtypes below list every field of the records, 8 bytes each
+static_assert(sizeof(ProportionRecord) == 12 * 8, "ProportionRecord layout changed, update its npy_descr");
+static_assert(sizeof(RadiusRecord) == 11 * 8, "RadiusRecord layout changed, update its npy_descr");
+
+// byte order mark of the .npy type strings
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  #define NPY_ENDIAN ">"
+#else
+  #define NPY_ENDIAN "<"
+#endif
+
+// ('name', '<u8') / ('name', '<f8') entry of a structured dtype
+static std::string npy_field(const char *name, const char kind, const bool last = false) {
+  return std::string("('") + name + "', '" NPY_ENDIAN + kind + "8')" + (last ? "" : ", ");
+}
+
+// NumPy format 1.0 header of a one dimensional array of count records, padded with spaces to size bytes
+// (0: the smallest multiple of 64 that holds it) so it can be rewritten in place with another count
+static std::string npy_header(const std::string &descr, const size_t count, const size_t size) {
+  std::string dict = "{'descr': " + descr + ", 'fortran_order': False, 'shape': (" + std::to_string(count) + ",), }";
+  const size_t prefix = 10;  // magic, version and header length
+  const size_t total = size > 0 ? size : (prefix + dict.size() + 1 + 63) / 64 * 64;
+
+  std::string header("\x93NUMPY\x01\x00", 8);
+  const size_t len = total - prefix;
+  header += static_cast<char>(len & 0xff);
+  header += static_cast<char>((len >> 8) & 0xff);
+  header += dict;
+  header.append(total - header.size() - 1, ' ');
+  header += '\n';
+  return header;
+}
+
+template<>
+const char *RecordFormat<ProportionRecord>::header() {
+  return "neurons,trained_patterns,test_patterns,test_pattern_hamming,simulations_per_step,min_proportion,mean_proportion,max_proportion,std_proportion,25_perc,mode,75_perc\n";
+}
+
+template<>
+void RecordFormat<ProportionRecord>::append_csv(std::string &out, const ProportionRecord &r) {
+  append_uint(out, r.neurons);
+  append_uint(out, r.train_patterns);
+  append_uint(out, r.test_patterns);
+  append_uint(out, r.hamming);
+  append_uint(out, r.simulations);
+  append_double(out, r.min, ',');
+  append_double(out, r.mean, ',');
+  append_double(out, r.max, ',');
+  append_double(out, r.std, ',');
+  append_double(out, r.perc25, ',');
+  append_double(out, r.mode, ',');
+  append_double(out, r.perc75, '\n');
+}
+
+template<>
+std::string RecordFormat<ProportionRecord>::npy_descr() {
+  return "[" + npy_field("neurons", 'u') + npy_field("trained_patterns", 'u') + npy_field("test_patterns", 'u')
+      + npy_field("test_pattern_hamming", 'u') + npy_field("simulations_per_step", 'u') + npy_field("min_proportion", 'f')
+      + npy_field("mean_proportion", 'f') + npy_field("max_proportion", 'f') + npy_field("std_proportion", 'f')
+      + npy_field("25_perc", 'f') + npy_field("mode", 'f') + npy_field("75_perc", 'f', true) + "]";
+}
+
+template<>
+const char *RecordFormat<RadiusRecord>::header() {
+  return "neurons,trained_patterns,test_patterns,threshold,simulations,min_radius,mean_radius,max_radius,std_radius,stderr_radius,mean_evaluations\n";
+}
+
+template<>
+void RecordFormat<RadiusRecord>::append_csv(std::string &out, const RadiusRecord &r) {
+  append_uint(out, r.neurons);
+  append_uint(out, r.train_patterns);
+  append_uint(out, r.test_patterns);
+  append_double(out, r.threshold, ',');
+  append_uint(out, r.simulations);
+  append_double(out, r.min, ',');
+  append_double(out, r.mean, ',');
+  append_double(out, r.max, ',');
+  append_double(out, r.std, ',');
+  append_double(out, r.stderr_radius, ',');
+  append_double(out, r.evaluations, '\n');
+}
+
+template<>
+std::string RecordFormat<RadiusRecord>::npy_descr() {
+  return "[" + npy_field("neurons", 'u') + npy_field("trained_patterns", 'u') + npy_field("test_patterns", 'u')
+      + npy_field("threshold", 'f') + npy_field("simulations", 'u') + npy_field("min_radius", 'f') + npy_field("mean_radius", 'f')
+      + npy_field("max_radius", 'f') + npy_field("std_radius", 'f') + npy_field("stderr_radius", 'f') + npy_field("mean_evaluations", 'f', true) + "]";
+}
+
+// summarize the simulation results of one grid point (sorts vals)
+ProportionRecord summarize_proportion(const size_t num_neurons, const size_t train_patterns, const size_t test_patterns, const size_t hamming, std::vector<double> &vals) {
+  const size_t sims = vals.size();
+
+  // get basic stats
+  double min = vals[0];
+  double max = vals[0];
+  double mean = 0.0;
+  for (size_t j = 0; j < sims; j++) {
+    min = std::min(min, vals[j]);
+    max = std::max(max, vals[j]);
+    mean += vals[j];
+  }
+  mean /= static_cast<double>(sims);
+
+  // calculate standard deviation (a single simulation has no spread)
+  double sum = 0.0;
+  for (size_t j = 0; j < sims; j++) {
+    sum += (vals[j] - mean)*(vals[j] - mean);
+  }
+  double std = sims > 1 ? std::sqrt(sum / static_cast<double>(sims - 1)) : 0.0;
+
+  // get percentiles
+  std::sort(vals.begin(), vals.end());
+  double twentyfive = vals[static_cast<size_t>(0.25 * sims)];
+  double mode = vals[static_cast<size_t>(0.50 * sims)];
+  double seventyfive = vals[static_cast<size_t>(0.75 * sims)];
+
+  return {num_neurons, train_patterns, test_patterns, hamming, sims, min, mean, max, std, twentyfive, mode, seventyfive};
+}
+
+template<typename R>
+ResultSink<R>::ResultSink(const std::string &base, const int format, const size_t num_records)
+    : records_(num_records), ready_(new std::atomic<bool>[num_records]), next_(0), writing_(false),
+      csv_path_(base + ".csv"), npy_path_(base + ".npy"), csv_fd_(-1), npy_fd_(-1), npy_header_(0), written_(0) {
+  for (size_t i = 0; i < num_records; i++) {
+    ready_[i] = false;
+  }
+  if (format & RESULTS_CSV) {
+    csv_fd_ = open_output(csv_path_);
+    csv_buf_.reserve(SINK_BUFFER_BYTES + 4096);
+    csv_buf_ += RecordFormat<R>::header();
+  }
+  if (format & RESULTS_NPY) {
+    npy_fd_ = open_output(npy_path_);
+    npy_header_ = npy_header(RecordFormat<R>::npy_descr(), num_records, 0).size();
+    npy_buf_.reserve(SINK_BUFFER_BYTES + sizeof(R));
+    npy_buf_ += npy_header(RecordFormat<R>::npy_descr(), 0, npy_header_);
+  }
+}
+
+template<typename R>
+ResultSink<R>::~ResultSink() {
+  if (csv_fd_ >= 0 || npy_fd_ >= 0) close();
+}
+
+// the ready flag and the writing flag are sequentially consistent: a thread that publishes the next
+// record while another one is writing either drains it itself or the writer sees it after letting go
+template<typename R>
+void ResultSink<R>::put(const size_t index, const R &record) {
+  records_[index] = record;
+  ready_[index].store(true);
+
+  size_t next;
+  while ((next = next_.load()) < records_.size() && ready_[next].load()) {
+    if (writing_.exchange(true)) return;  // the current writer picks it up
+    drain();
+    unlock();
+  }
+}
+
+template<typename R>
+void ResultSink<R>::lock() {
+  while (writing_.exchange(true)) {
+    std::this_thread::yield();
+  }
+}
+
+// format the run of ready records from next_ on (holding writing_)
+template<typename R>
+void ResultSink<R>::drain() {
+  size_t next = next_.load();
+  const size_t first = next;
+  while (next < records_.size() && ready_[next].load()) {
+    next++;
+  }
+  if (csv_fd_ >= 0) {
+    for (size_t i = first; i < next; i++) {
+      RecordFormat<R>::append_csv(csv_buf_, records_[i]);
+    }
+  }
+  if (npy_fd_ >= 0 && next > first) {
+    npy_buf_.append(reinterpret_cast<const char*>(&records_[first]), (next - first) * sizeof(R));
+  }
+  next_.store(next);
+
+  if (csv_buf_.size() >= SINK_BUFFER_BYTES || npy_buf_.size() >= SINK_BUFFER_BYTES) {
+    write_out();
+  }
+}
+
+template<typename R>
+void ResultSink<R>::write_out() {
+  if (csv_fd_ >= 0) {
+    write_all(csv_fd_, csv_path_, csv_buf_);
+  }
+  if (npy_fd_ >= 0) {
+    write_all(npy_fd_, npy_path_, npy_buf_);
+  }
+  written_ = next_.load();
+}
+
+template<typename R>
+void ResultSink<R>::checkpoint() {
+  lock();
+  drain();
+  write_out();
+  if (csv_fd_ >= 0 && fsync(csv_fd_) != 0) {
+    sink_error(csv_path_, "fsync failed");
+  }
+  if (npy_fd_ >= 0) {
+    // make the header count the records now in the file
+    std::string header = npy_header(RecordFormat<R>::npy_descr(), written_, npy_header_);
+    if (pwrite(npy_fd_, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size())) {
+      sink_error(npy_path_, "header update failed");
+    }
+    if (fsync(npy_fd_) != 0) {
+      sink_error(npy_path_, "fsync failed");
+    }
+  }
+  unlock();
+}
+
+template<typename R>
+void ResultSink<R>::close() {
+  checkpoint();
+  if (next_.load() != records_.size()) {
+    std::cerr << "Only " << next_.load() << " of " << records_.size() << " records were written to " << (csv_fd_ >= 0 ? csv_path_ : npy_path_) << std::endl;
+    std::exit(1);
+  }
+
+  if (csv_fd_ >= 0) {
+    ::close(csv_fd_);
+    csv_fd_ = -1;
+  }
+  if (npy_fd_ >= 0) {
+    ::close(npy_fd_);
+    npy_fd_ = -1;
+  }
+}
+
+// force declarations of the following templates
+template class ResultSink<ProportionRecord>;
+template class ResultSink<RadiusRecord>;
@@ -0,0 +1,93 @@
+#ifndef SINK_HPP
+#define SINK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+// bytes of formatted output collected before they are written out in one call
+#define SINK_BUFFER_BYTES (1 << 20)
+
+// summary of one (neurons, trained patterns, hamming) point of the proportion sweep
+// (a row of proportion-data.csv / .npy, all fields 8 bytes so the binary layout has no padding)
+struct ProportionRecord {
+  uint64_t neurons, train_patterns, test_patterns, hamming, simulations;
+  double   min, mean, max, std, perc25, mode, perc75;
+};
+
+// summary of the simulation results of one grid point (sorts vals)
+ProportionRecord summarize_proportion(const size_t num_neurons, const size_t train_patterns, const size_t test_patterns, const size_t hamming, std::vector<double> &vals);
+
+// summary of one (neurons, trained patterns) pair of the basin radius estimation (a row of basin-radius.csv)
+struct RadiusRecord {
+  uint64_t neurons, train_patterns, test_patterns;
+  double   threshold;
+  uint64_t simulations;
+  double   min, mean, max, std, stderr_radius, evaluations;
+};
+
+// which files a sink writes (--format csv|npy|both)
+enum ResultFormat {
+  RESULTS_CSV = 1,
+  RESULTS_NPY = 2,
+  RESULTS_BOTH = RESULTS_CSV | RESULTS_NPY
+};
+
+// CSV and .npy layout of a record type (the .npy fields are named as the CSV columns)
+template<typename R>
+struct RecordFormat {
+  static const char *header();
+  static void append_csv(std::string &out, const R &record);
+  static std::string npy_descr();
+};
+
+// ordered, buffered writer of the summarized grid points of a sweep
+// any thread hands in the record of point index once it is final (put never blocks), the records
+// are written strictly in index order no matter in which order the points finish, so reruns produce
+// identical files. Whichever thread publishes the next missing record also drains the run of ready
+// records behind it into the output buffers, which are written in batches of SINK_BUFFER_BYTES.
+//   <base>.csv: the header then one row per record
+//   <base>.npy: a NumPy (format 1.0) structured array of the records, one field per CSV column in
+//               their native in memory layout, so np.load(path, mmap_mode='r') uses the data in place.
+//               its header is padded to a fixed size and rewritten with the number of records written
+//               at every checkpoint, so the file always loads (with the finished prefix of the grid)
+template<typename R>
+class ResultSink {
+public:
+  // write <base>.csv and/or <base>.npy (format is a ResultFormat)
+  ResultSink(const std::string &base, const int format, const size_t num_records);
+  ~ResultSink();
+  ResultSink(const ResultSink &) = delete;
+  ResultSink &operator=(const ResultSink &) = delete;
+
+  void put(const size_t index, const R &record);
+
+  // write out everything ordered so far and fsync it (safe to call from any thread)
+  void checkpoint();
+
+  // write out every record and close the files (all of them must have been put)
+  void close();
+
+  size_t num_records() const { return records_.size(); }
+
+private:
+  void drain();
+  void write_out();
+  void lock();
+  void unlock() { writing_.store(false); }
+
+  std::vector<R>                       records_;
+  std::unique_ptr<std::atomic<bool>[]> ready_;
+  std::atomic<size_t>                  next_;     // first record not yet drained
+  std::atomic<bool>                    writing_;  // a thread is draining or writing
+  std::string                          csv_path_, npy_path_;
+  int                                  csv_fd_, npy_fd_;
+  std::string                          csv_buf_, npy_buf_;
+  size_t                               npy_header_;  // bytes of the padded .npy header
+  size_t                               written_;     // records written out
+};
+
+#endif
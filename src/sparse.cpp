@@ -0,0 +1,185 @@
+#include "sparse.hpp"
+#include "recall.hpp"
+#include "arena.hpp"
+#include "util.hpp"
+#include <omp.h>
+#include <cmath>
+#include <algorithm>
+
+template <typename T>
+void SparseMatrix<T>::set_all(const T &val) {
+  std::fill(values_.begin(), values_.end(), val);
+}
+
+template <typename T>
+void SparseMatrix<T>::zeroize() {
+  set_all(0.0);
+  num_patterns_ = 0;
+}
+
+// symmetric random dilution, row i draws its neighbours j > i by geometric skips
+// from its own stream (in parallel), the mirrored j < i half is then filled by a transpose
+template <typename T>
+void SparseMatrix<T>::dilute(const double connectivity, Rng &rng) {
+  const size_t N = num_rows_;
+  std::vector<std::vector<index_t>> upper(N);
+  const Rng base = rng.split(rng());
+
+  if (connectivity > 0.0) {
+    const double log_skip = std::log1p(-std::min(connectivity, 1.0 - 1e-12));
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t i = 0; i < N; i++) {
+      Rng row_rng = base.split(i);
+      size_t j = i;
+      while (true) {
+        // gap to the next connection is geometric with success probability connectivity
+        double u = 1.0 - row_rng.uniform(); // (0, 1]
+        size_t skip = (connectivity >= 1.0) ? 0 : static_cast<size_t>(std::log(u) / log_skip);
+        j += skip + 1;
+        if (j >= N) break;
+        upper[i].push_back(static_cast<index_t>(j));
+      }
+    }
+  }
+
+  // degree of every row = its upper neighbours + the rows that picked it
+  std::vector<size_t> lower(N, 0);
+  for (size_t i = 0; i < N; i++) {
+    for (index_t j : upper[i]) {
+      lower[j]++;
+    }
+  }
+
+  row_ptr_.assign(N + 1, 0);
+  for (size_t i = 0; i < N; i++) {
+    row_ptr_[i + 1] = row_ptr_[i] + lower[i] + upper[i].size();
+  }
+  col_idx_.assign(row_ptr_[N], 0);
+  values_.assign(row_ptr_[N], 0);
+
+  // upper halves go after each row's lower half (rows are independent)
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t i = 0; i < N; i++) {
+    std::copy(upper[i].begin(), upper[i].end(), col_idx_.begin() + row_ptr_[i] + lower[i]);
+  }
+
+  // lower halves in ascending i so every row stays sorted
+  std::vector<size_t> cursor(row_ptr_.begin(), row_ptr_.end() - 1);
+  for (size_t i = 0; i < N; i++) {
+    for (index_t j : upper[i]) {
+      col_idx_[cursor[j]++] = static_cast<index_t>(i);
+    }
+  }
+  num_patterns_ = 0;
+}
+
+template <typename T>
+void SparseMatrix<T>::nearest(const size_t k) {
+  const size_t N = num_rows_;
+  const size_t half = std::min(k / 2, (N - 1) / 2);
+  const size_t deg = 2 * half;
+
+  row_ptr_.assign(N + 1, 0);
+  for (size_t i = 0; i < N; i++) {
+    row_ptr_[i + 1] = row_ptr_[i] + deg;
+  }
+  col_idx_.assign(N * deg, 0);
+  values_.assign(N * deg, 0);
+
+  #pragma omp parallel for
+  for (size_t i = 0; i < N; i++) {
+    index_t *cols = &col_idx_[i * deg];
+    for (size_t d = 1; d <= half; d++) {
+      cols[2 * (d - 1)] = static_cast<index_t>((i + N - d) % N);
+      cols[2 * (d - 1) + 1] = static_cast<index_t>((i + d) % N);
+    }
+    std::sort(cols, cols + deg);
+  }
+  num_patterns_ = 0;
+}
+
+template <typename T>
+T SparseMatrix<T>::operator()(size_t i, size_t j) const {
+  const index_t *first = &col_idx_[row_ptr_[i]];
+  const index_t *last = first + degree(i);
+  const index_t *it = std::lower_bound(first, last, static_cast<index_t>(j));
+  return (it != last && *it == j) ? values_[row_ptr_[i] + (it - first)] : static_cast<T>(0);
+}
+
+template <typename T>
+void SparseMatrix<T>::train_on(patterns_t &patterns) {
+  // pack into bits and use the popcount kernel
+  packed_patterns_t packed;
+  packed.reserve(patterns.size());
+  for (size_t p = 0; p < patterns.size(); ++p) {
+    packed.push_back(PackedPattern(patterns.at(p)));
+  }
+  train_on(packed);
+}
+
+// Hebb's rule on the existing connections only, w_ij = (P - 2 * popcount(bits_i ^ bits_j)) / P
+template <typename T>
+void SparseMatrix<T>::train_on(packed_patterns_t &patterns) {
+  INSTR_COUNT(INSTR_TRAININGS, 1);
+  if (patterns.empty()) {
+    zeroize();
+    return;
+  }
+
+  Scratch<PackedPattern::word_t, SCRATCH_BITS> bits_lease;
+  std::vector<PackedPattern::word_t> &bits = *bits_lease;
+  const size_t pw = transpose_patterns(patterns, bits);
+  const double pattern_n = static_cast<double>(patterns.size());
+  const double inv_p = 1.0 / pattern_n;
+
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t i = 0; i < num_rows_; i++) {
+    const PackedPattern::word_t *xi = &bits[i * pw];
+    for (size_t k = row_ptr_[i]; k < row_ptr_[i + 1]; k++) {
+      const PackedPattern::word_t *xj = &bits[static_cast<size_t>(col_idx_[k]) * pw];
+      long diff = 0;
+      for (size_t w = 0; w < pw; w++) {
+        diff += __builtin_popcountll(xi[w] ^ xj[w]);
+      }
+      values_[k] = static_cast<T>((pattern_n - 2.0 * static_cast<double>(diff)) * inv_p);
+    }
+  }
+  num_patterns_ = patterns.size();
+}
+
+template<typename T>
+size_t SparseMatrix<T>::run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng) const {
+  Recall<SparseMatrix<T>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
+
+  return steps;
+}
+
+template<typename T>
+size_t SparseMatrix<T>::run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng) const {
+  Recall<SparseMatrix<T>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
+
+  return steps;
+}
+
+template<typename T>
+size_t SparseMatrix<T>::run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<SparseMatrix<T>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
+
+template<typename T>
+size_t SparseMatrix<T>::run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<SparseMatrix<T>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
+
+// force declarations of the following templates
+template class SparseMatrix<float>;
+template class SparseMatrix<double>;
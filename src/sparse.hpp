@@ -0,0 +1,136 @@
+#ifndef SPARSE_HPP
+#define SPARSE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include "vector.hpp"
+#include "packed.hpp"
+#include "random.hpp"
+#include "instrument.hpp"
+#include "util.hpp"
+
+// diluted Hopfield network with symmetric connectivity stored as CSR
+// (row i holds the sorted neurons connected to i and their weights), weights are only
+// learned on existing connections so memory and every recall pass are O(N * degree)
+// it provides the same training/recall interface as Matrix (train_on, energy, run_to_min, ...)
+template<typename T>
+class SparseMatrix {
+public:
+  typedef uint32_t index_t;
+
+  SparseMatrix(size_t N) : num_rows_(N), num_patterns_(0), row_ptr_(N + 1, 0) {}
+
+  // connectivity (replaces any existing connections and zeroes the weights)
+  void dilute(const double connectivity, Rng &rng);  // every pair connected with probability connectivity
+  void nearest(const size_t k);                       // ring lattice with the k nearest neighbours (k/2 per side)
+
+  void set_all(const T &);
+  void zeroize();
+
+  // local fields h = W x
+  template<typename F>
+  void fields(const F *x, F *h) const {
+    for (size_t i = 0; i < num_rows_; i++) {
+      const index_t *cols = &col_idx_[row_ptr_[i]];
+      const T *vals = &values_[row_ptr_[i]];
+      const size_t len = row_ptr_[i + 1] - row_ptr_[i];
+      F hoist = 0.0;
+
+      #pragma omp simd reduction(+:hoist)
+      for (size_t e = 0; e < len; e++) {
+        hoist += static_cast<F>(vals[e]) * x[cols[e]];
+      }
+      h[i] = hoist;
+    }
+  }
+
+  // fields of a batch of probes h[b * ld + i] (each row's indices and weights are reused for 4 probes)
+  template<typename F>
+  void fields_batch(const F *x, F *h, const size_t count, const size_t ld) const {
+    size_t b = 0;
+    for (; b + 4 <= count; b += 4) {
+      const F *x0 = x + b * ld, *x1 = x0 + ld, *x2 = x1 + ld, *x3 = x2 + ld;
+      for (size_t i = 0; i < num_rows_; i++) {
+        const index_t *cols = &col_idx_[row_ptr_[i]];
+        const T *vals = &values_[row_ptr_[i]];
+        const size_t len = row_ptr_[i + 1] - row_ptr_[i];
+        F a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0;
+
+        #pragma omp simd reduction(+:a0,a1,a2,a3)
+        for (size_t e = 0; e < len; e++) {
+          const F w = static_cast<F>(vals[e]);
+          const index_t j = cols[e];
+          a0 += w * x0[j];
+          a1 += w * x1[j];
+          a2 += w * x2[j];
+          a3 += w * x3[j];
+        }
+        h[b * ld + i] = a0;
+        h[(b + 1) * ld + i] = a1;
+        h[(b + 2) * ld + i] = a2;
+        h[(b + 3) * ld + i] = a3;
+      }
+    }
+
+    for (; b < count; b++) {
+      fields(x + b * ld, h + b * ld);
+    }
+  }
+
+  // h += scale * W[:, k] (symmetric so the column is row k)
+  template<typename F>
+  void add_column(size_t k, const F &scale, F *h) const {
+    const index_t *cols = &col_idx_[row_ptr_[k]];
+    const T *vals = &values_[row_ptr_[k]];
+    const size_t len = row_ptr_[k + 1] - row_ptr_[k];
+
+    #pragma omp simd
+    for (size_t e = 0; e < len; e++) {
+      h[cols[e]] += scale * static_cast<F>(vals[e]);
+    }
+  }
+
+  template<typename P>
+  double energy(const P &pattern) const {
+    INSTR_COUNT(INSTR_ENERGY_EVALS, 1);
+    double e = 0.0;
+
+    for (size_t i = 0; i < num_rows_; i++) {
+      double vc = static_cast<double>(pattern(i)); // cache current s_i
+      for (size_t k = row_ptr_[i]; k < row_ptr_[i + 1]; k++) {
+        e -= static_cast<double>(values_[k]) * vc * static_cast<double>(pattern(col_idx_[k]));
+      }
+    }
+
+    return 0.5 * e;
+  }
+
+  void train_on(patterns_t &patterns);
+  void train_on(packed_patterns_t &patterns);
+  size_t run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+
+  // weight of connection i-j (0 when not connected)
+  T operator()(size_t i, size_t j) const;
+
+  size_t num_rows() const { return num_rows_; }
+  size_t num_cols() const { return num_rows_; }
+  size_t num_nonzeros() const { return col_idx_.size(); }
+  size_t num_patterns() const { return num_patterns_; }
+  size_t degree(size_t i) const { return row_ptr_[i + 1] - row_ptr_[i]; }
+
+private:
+  size_t               num_rows_;
+  size_t               num_patterns_;
+  std::vector<size_t>  row_ptr_;
+  std::vector<index_t> col_idx_;
+  std::vector<T>       values_;
+};
+
+typedef SparseMatrix<double> sparse_hopfield_t;
+
+#endif
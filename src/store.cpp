@@ -0,0 +1,193 @@
+#include "store.hpp"
+#include "recall.hpp"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static void store_error(const std::string &path, const std::string &what) {
+  std::cerr << "Cannot use " << path << ": " << what << std::endl;
+  std::exit(1);
+}
+
+// header, zero padding up to the aligned data section and the data itself
+static void write_store(const std::string &path, const uint32_t kind, const uint32_t dtype, const uint64_t rows, const uint64_t cols,
+                        const uint64_t count, const void *data, const uint64_t bytes) {
+  StoreHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+  header.version = STORE_VERSION;
+  header.endian = STORE_ENDIAN;
+  header.kind = kind;
+  header.dtype = dtype;
+  header.rows = rows;
+  header.cols = cols;
+  header.count = count;
+  header.offset = STORE_ALIGN;
+  header.bytes = bytes;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    store_error(path, "open for writing failed");
+  }
+  std::vector<char> padding(header.offset - sizeof(header), 0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+  out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+  if (!out) {
+    store_error(path, "write failed");
+  }
+}
+
+template<typename T>
+void save_weights(const std::string &path, const Matrix<T> &weights) {
+  const uint64_t bytes = weights.num_rows() * weights.num_cols() * sizeof(T);
+  const T *data = bytes > 0 ? &weights(0, 0) : nullptr;  // an empty matrix has no first element
+  write_store(path, STORE_WEIGHTS, StoreTypeOf<T>::value, weights.num_rows(), weights.num_cols(), weights.num_patterns(), data, bytes);
+}
+
+void save_patterns(const std::string &path, const packed_patterns_t &patterns) {
+  const size_t N = patterns.empty() ? 0 : patterns[0].num_rows();
+  const size_t pw = PackedPattern::words_for(N);
+
+  std::vector<PackedPattern::word_t> words(patterns.size() * pw);
+  for (size_t p = 0; p < patterns.size(); p++) {
+    if (patterns[p].num_rows() != N) {
+      store_error(path, "patterns differ in size");
+    }
+    std::copy(patterns[p].words(), patterns[p].words() + pw, words.begin() + p * pw);
+  }
+  write_store(path, STORE_PATTERNS, STORE_BITS, N, pw, patterns.size(), words.data(), words.size() * sizeof(PackedPattern::word_t));
+}
+
+// bytes of one element of a data section
+static uint64_t store_type_size(const uint32_t dtype) {
+  switch (dtype) {
+    case STORE_F64:  return sizeof(double);
+    case STORE_F32:  return sizeof(float);
+    case STORE_I8:   return sizeof(int8_t);
+    case STORE_I16:  return sizeof(int16_t);
+    case STORE_I32:  return sizeof(int32_t);
+    case STORE_BITS: return sizeof(PackedPattern::word_t);
+    default:         return 0;
+  }
+}
+
+// is bytes exactly a x b elements of size bytes (checked without overflowing)
+static bool spans(const uint64_t bytes, const uint64_t a, const uint64_t b, const uint64_t size) {
+  if (size == 0) return false;
+  if (a == 0 || b == 0) return bytes == 0;
+  return b <= bytes / size / a && a * b * size == bytes;
+}
+
+MappedStore::MappedStore(const std::string &path, const uint32_t kind, const uint32_t dtype) : addr_(NULL), length_(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    store_error(path, "open failed");
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(StoreHeader)) {
+    close(fd);
+    store_error(path, "not a store file");
+  }
+  length_ = static_cast<size_t>(info.st_size);
+  addr_ = mmap(NULL, length_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping keeps the file alive
+  if (addr_ == MAP_FAILED) {
+    addr_ = NULL;
+    store_error(path, "mmap failed");
+  }
+
+  const StoreHeader &head = header();
+  if (std::memcmp(head.magic, STORE_MAGIC, sizeof(head.magic)) != 0) {
+    store_error(path, "not a store file");
+  }
+  if (head.endian != STORE_ENDIAN) {
+    store_error(path, "written with a different byte order");
+  }
+  if (head.version != STORE_VERSION) {
+    store_error(path, "unsupported version " + std::to_string(head.version));
+  }
+  if (head.kind != kind || head.dtype != dtype) {
+    store_error(path, "holds kind " + std::to_string(head.kind) + " of type " + std::to_string(head.dtype)
+                + ", expected kind " + std::to_string(kind) + " of type " + std::to_string(dtype));
+  }
+  if (head.offset % STORE_ALIGN != 0 || head.offset < sizeof(StoreHeader) || head.offset > length_ || head.bytes > length_ - head.offset) {
+    store_error(path, "truncated or misaligned data section");
+  }
+
+  // the views index the data section by the shape in the header without further checks
+  if (kind == STORE_WEIGHTS && (head.rows != head.cols || !spans(head.bytes, head.rows, head.cols, store_type_size(dtype)))) {
+    store_error(path, "the data section does not hold a square matrix of " + std::to_string(head.rows) + " x " + std::to_string(head.cols));
+  }
+  const uint64_t words = head.rows / PackedPattern::WORD_BITS + (head.rows % PackedPattern::WORD_BITS != 0);
+  if (kind == STORE_PATTERNS && (head.cols != words || !spans(head.bytes, head.count, head.cols, store_type_size(dtype)))) {
+    store_error(path, "the data section does not hold " + std::to_string(head.count) + " patterns of " + std::to_string(head.rows) + " neurons");
+  }
+}
+
+MappedStore::~MappedStore() {
+  if (addr_ != NULL) {
+    munmap(addr_, length_);
+  }
+}
+
+template<typename T>
+size_t MatrixView<T>::run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng) const {
+  Recall<MatrixView<T>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
+
+  return steps;
+}
+
+template<typename T>
+size_t MatrixView<T>::run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng) const {
+  Recall<MatrixView<T>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
+
+  return steps;
+}
+
+template<typename T>
+size_t MatrixView<T>::run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<MatrixView<T>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
+
+template<typename T>
+size_t MatrixView<T>::run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<MatrixView<T>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
+
+PackedPattern PatternsView::pattern(size_t p) const {
+  PackedPattern out(num_rows_);
+  std::copy(words(p), words(p) + num_words_, out.words());
+  return out;
+}
+
+packed_patterns_t PatternsView::patterns() const {
+  packed_patterns_t out;
+  out.reserve(size_);
+  for (size_t p = 0; p < size_; p++) {
+    out.push_back(pattern(p));
+  }
+  return out;
+}
+
+// force declarations of the following templates
+template void save_weights<double>(const std::string &, const Matrix<double> &);
+template void save_weights<int>(const std::string &, const Matrix<int> &);
+template void save_weights<short>(const std::string &, const Matrix<short> &);
+template class MatrixView<double>;
+template class MatrixView<int>;
+template class MatrixView<short>;
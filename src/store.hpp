@@ -0,0 +1,216 @@
+#ifndef STORE_HPP
+#define STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "matrix.hpp"
+#include "packed.hpp"
+#include "bipolar.hpp"
+#include "random.hpp"
+#include "instrument.hpp"
+
+// versioned binary files for trained weights and pattern sets
+//   [StoreHeader (64 bytes)] [zero padding] [data section at header.offset]
+// the data section starts on a STORE_ALIGN boundary so a read-only mmap of the file can be
+// used in place (no parsing or copying) by any number of threads or processes
+//   weights:  rows x cols row-major values of header.dtype, count = patterns the weights were trained on
+//   patterns: count patterns of rows neurons as PackedPattern words, cols = words per pattern
+#define STORE_MAGIC "HOPFSTOR"
+#define STORE_VERSION 1
+#define STORE_ALIGN 4096 // page aligned (and so cache line aligned) data sections
+#define STORE_ENDIAN 0x01020304u // written natively, a foreign byte order reads back swapped
+
+enum StoreKind {
+  STORE_WEIGHTS = 1,
+  STORE_PATTERNS = 2
+};
+
+enum StoreType {
+  STORE_F64 = 1,
+  STORE_F32 = 2,
+  STORE_I8 = 3,
+  STORE_I16 = 4,
+  STORE_I32 = 5,
+  STORE_BITS = 6 // 64-bit PackedPattern words
+};
+
+struct StoreHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint32_t kind;
+  uint32_t dtype;
+  uint64_t rows, cols, count;
+  uint64_t offset, bytes;  // data section
+};
+static_assert(sizeof(StoreHeader) == 64, "store header layout changed, bump STORE_VERSION");
+
+// element type of a data section
+template<typename T> struct StoreTypeOf;
+template<> struct StoreTypeOf<double>   { static const uint32_t value = STORE_F64; };
+template<> struct StoreTypeOf<float>    { static const uint32_t value = STORE_F32; };
+template<> struct StoreTypeOf<int8_t>   { static const uint32_t value = STORE_I8; };
+template<> struct StoreTypeOf<int16_t>  { static const uint32_t value = STORE_I16; };
+template<> struct StoreTypeOf<int32_t>  { static const uint32_t value = STORE_I32; };
+template<> struct StoreTypeOf<uint64_t> { static const uint32_t value = STORE_BITS; };
+
+// read-only mapping of a store file, the header is validated against kind and dtype
+// (a bad file is reported and exits as everywhere else)
+class MappedStore {
+public:
+  MappedStore(const std::string &path, const uint32_t kind, const uint32_t dtype);
+  ~MappedStore();
+  MappedStore(const MappedStore &) = delete;
+  MappedStore &operator=(const MappedStore &) = delete;
+
+  const StoreHeader &header() const { return *static_cast<const StoreHeader*>(addr_); }
+  const void *data() const { return static_cast<const char*>(addr_) + header().offset; }
+
+private:
+  void   *addr_;
+  size_t length_;
+};
+
+// write the trained weights of a dense matrix
+template<typename T>
+void save_weights(const std::string &path, const Matrix<T> &weights);
+
+// write a set of patterns (all of the same size) packed into bits
+void save_patterns(const std::string &path, const packed_patterns_t &patterns);
+
+// weights used in place from a mapped file, read-only so one view can be shared by every
+// thread, it provides the weight interface of the recall engines (see recall.hpp)
+template<typename T>
+class MatrixView {
+public:
+  MatrixView(const std::string &path) : store_(path, STORE_WEIGHTS, StoreTypeOf<T>::value),
+    data_(static_cast<const T*>(store_.data())), num_rows_(store_.header().rows), num_cols_(store_.header().cols),
+    num_patterns_(store_.header().count) {}
+
+  const T& operator()(size_t i, size_t j) const { return data_[i * num_cols_ + j]; }
+
+  template<typename F>
+  void fields(const F *x, F *h) const {
+    for (size_t i = 0; i < num_rows_; i++) {
+      const T *row = data_ + i * num_cols_;
+      F hoist = 0.0;
+
+      #pragma omp simd reduction(+:hoist)
+      for (size_t j = 0; j < num_cols_; j++) {
+        hoist += static_cast<F>(row[j]) * x[j];
+      }
+      h[i] = hoist;
+    }
+  }
+
+  // local fields from packed -1/1 states (multiply-free, see bipolar.hpp)
+  template<typename F>
+  void fields(const PackedPattern &s, F *h) const {
+    for (size_t i = 0; i < num_rows_; i++) {
+      h[i] = static_cast<F>(bipolar_dot(data_ + i * num_cols_, s.words(), num_cols_));
+    }
+  }
+
+  // fields of a batch of probes h[b * ld + i] (each weight row is reused for 4 probes)
+  template<typename F>
+  void fields_batch(const F *x, F *h, const size_t count, const size_t ld) const {
+    size_t b = 0;
+    for (; b + 4 <= count; b += 4) {
+      const F *x0 = x + b * ld, *x1 = x0 + ld, *x2 = x1 + ld, *x3 = x2 + ld;
+      for (size_t i = 0; i < num_rows_; i++) {
+        const T *row = data_ + i * num_cols_;
+        F a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0;
+
+        #pragma omp simd reduction(+:a0,a1,a2,a3)
+        for (size_t j = 0; j < num_cols_; j++) {
+          const F w = static_cast<F>(row[j]);
+          a0 += w * x0[j];
+          a1 += w * x1[j];
+          a2 += w * x2[j];
+          a3 += w * x3[j];
+        }
+        h[b * ld + i] = a0;
+        h[(b + 1) * ld + i] = a1;
+        h[(b + 2) * ld + i] = a2;
+        h[(b + 3) * ld + i] = a3;
+      }
+    }
+
+    for (; b < count; b++) {
+      fields(x + b * ld, h + b * ld);
+    }
+  }
+
+  // h += scale * W[:, k] (symmetric so the column is row k)
+  template<typename F>
+  void add_column(size_t k, const F &scale, F *h) const {
+    const T *col = data_ + k * num_cols_;
+
+    #pragma omp simd
+    for (size_t j = 0; j < num_cols_; j++) {
+      h[j] += scale * static_cast<F>(col[j]);
+    }
+  }
+
+  template<typename P>
+  double energy(const P &pattern) const {
+    INSTR_COUNT(INSTR_ENERGY_EVALS, 1);
+    double e = 0.0;
+
+    for (size_t i = 0; i < num_rows_; i++) {
+      double vc = static_cast<double>(pattern(i)); // cache current s_i
+      for (size_t j = 0; j < num_cols_; j++) {
+        e -= static_cast<double>(data_[i * num_cols_ + j]) * vc * static_cast<double>(pattern(j));
+      }
+    }
+
+    return 0.5 * e;
+  }
+
+  size_t run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+
+  size_t num_rows() const { return num_rows_; }
+  size_t num_cols() const { return num_cols_; }
+  size_t num_patterns() const { return num_patterns_; }
+
+private:
+  MappedStore store_;
+  const T     *data_;
+  size_t      num_rows_, num_cols_;
+  size_t      num_patterns_;
+};
+
+// pattern set used in place from a mapped file
+class PatternsView {
+public:
+  PatternsView(const std::string &path) : store_(path, STORE_PATTERNS, STORE_BITS),
+    data_(static_cast<const PackedPattern::word_t*>(store_.data())), num_rows_(store_.header().rows),
+    num_words_(store_.header().cols), size_(store_.header().count) {}
+
+  // words of pattern p (num_words() of them)
+  const PackedPattern::word_t *words(size_t p) const { return data_ + p * num_words_; }
+
+  // copy of pattern p / of the whole set
+  PackedPattern pattern(size_t p) const;
+  packed_patterns_t patterns() const;
+
+  size_t size() const { return size_; }
+  size_t num_rows() const { return num_rows_; }
+  size_t num_words() const { return num_words_; }
+
+private:
+  MappedStore                 store_;
+  const PackedPattern::word_t *data_;
+  size_t                      num_rows_, num_words_;
+  size_t                      size_;
+};
+
+typedef MatrixView<double> hopfield_view_t;
+
+#endif
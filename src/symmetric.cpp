@@ -0,0 +1,172 @@
+#include "symmetric.hpp"
+#include "recall.hpp"
+#include "arena.hpp"
+#include "util.hpp"
+#include <omp.h>
+#include <cmath>
+#include <algorithm>
+
+template <typename T>
+void SymMatrix<T>::set_all(const T &val) {
+  // only the strict upper triangle (lower halves of diagonal tiles and padding stay zero)
+  for (size_t bi = 0; bi < num_tiles_; bi++) {
+    for (size_t bj = bi; bj < num_tiles_; bj++) {
+      T *t = tile(bi, bj);
+      const size_t i0 = bi * SYM_TILE, j0 = bj * SYM_TILE;
+      for (size_t r = 0; r < SYM_TILE; r++) {
+        for (size_t c = 0; c < SYM_TILE; c++) {
+          const size_t i = i0 + r, j = j0 + c;
+          t[r * SYM_TILE + c] = (j > i && j < num_rows_) ? val : static_cast<T>(0);
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+void SymMatrix<T>::zeroize() {
+  std::fill(storage_.begin(), storage_.end(), static_cast<T>(0));
+  num_patterns_ = 0;
+}
+
+template <typename T>
+void SymMatrix<T>::train_on(patterns_t &patterns) {
+  // pack into bits and use the popcount kernel
+  packed_patterns_t packed;
+  packed.reserve(patterns.size());
+  for (size_t p = 0; p < patterns.size(); ++p) {
+    packed.push_back(PackedPattern(patterns.at(p)));
+  }
+  train_on(packed);
+}
+
+// Hebb's rule, W = X^T X / P with a zero diagonal
+template <typename T>
+void SymMatrix<T>::train_on(packed_patterns_t &patterns) {
+  if (patterns.empty()) {
+    zeroize();
+    return;
+  }
+
+  hebbian(patterns, 0.0, 1.0 / static_cast<double>(patterns.size()));
+  num_patterns_ = patterns.size();
+}
+
+template<typename T>
+void SymMatrix<T>::add_pattern(const packed_pattern_t &pattern) {
+  add_patterns(packed_patterns_t(1, pattern));
+}
+
+// W' = (P W + X^T X) / (P + dP)
+template<typename T>
+void SymMatrix<T>::add_patterns(const packed_patterns_t &patterns) {
+  if (patterns.empty()) return;
+
+  const double old_n = static_cast<double>(num_patterns_);
+  const double new_n = static_cast<double>(num_patterns_ + patterns.size());
+  hebbian(patterns, old_n / new_n, 1.0 / new_n);
+  num_patterns_ += patterns.size();
+}
+
+template<typename T>
+void SymMatrix<T>::remove_pattern(const packed_pattern_t &pattern) {
+  remove_patterns(packed_patterns_t(1, pattern));
+}
+
+// W' = (P W - X^T X) / (P - dP), unlearning every pattern leaves zero weights
+template<typename T>
+void SymMatrix<T>::remove_patterns(const packed_patterns_t &patterns) {
+  if (patterns.empty()) return;
+  if (patterns.size() > num_patterns_) {
+    std::cerr << "Cannot remove " << patterns.size() << " patterns from a network trained on " << num_patterns_ << std::endl;
+    std::exit(1);
+  }
+
+  if (patterns.size() == num_patterns_) {
+    zeroize();
+    return;
+  }
+
+  const double old_n = static_cast<double>(num_patterns_);
+  const double new_n = static_cast<double>(num_patterns_ - patterns.size());
+  hebbian(patterns, old_n / new_n, -1.0 / new_n);
+  num_patterns_ -= patterns.size();
+}
+
+// w_ij = keep * w_ij + scale * (P - 2 * popcount(bits_i ^ bits_j)) for i < j,
+// one stored tile at a time (no mirroring, the tile is both halves)
+template<typename T>
+void SymMatrix<T>::hebbian(const packed_patterns_t &patterns, const double keep, const double scale) {
+  INSTR_COUNT(INSTR_TRAININGS, 1);
+
+  // the P states of neuron i live in bits[i * pw .. (i + 1) * pw)
+  Scratch<PackedPattern::word_t, SCRATCH_BITS> bits_lease;
+  std::vector<PackedPattern::word_t> &bits = *bits_lease;
+  const size_t pw = transpose_patterns(patterns, bits);
+  const double pattern_n = static_cast<double>(patterns.size());
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t bi = 0; bi < num_tiles_; bi++) {
+    const size_t i0 = bi * SYM_TILE;
+    const size_t i1 = std::min(num_rows_, i0 + SYM_TILE);
+
+    for (size_t bj = bi; bj < num_tiles_; bj++) {
+      const size_t j0 = bj * SYM_TILE;
+      const size_t j1 = std::min(num_rows_, j0 + SYM_TILE);
+      T *t = tile(bi, bj);
+
+      for (size_t i = i0; i < i1; i++) {
+        const PackedPattern::word_t *xi = &bits[i * pw];
+        T *row = t + (i - i0) * SYM_TILE - j0;
+        const size_t js = std::max(j0, i + 1);
+
+        #pragma omp simd
+        for (size_t j = js; j < j1; j++) {
+          const PackedPattern::word_t *xj = &bits[j * pw];
+          long diff = 0;
+          for (size_t w = 0; w < pw; w++) {
+            diff += __builtin_popcountll(xi[w] ^ xj[w]);
+          }
+          const double dot = pattern_n - 2.0 * static_cast<double>(diff);
+          row[j] = static_cast<T>(((keep == 0.0) ? 0.0 : keep * static_cast<double>(row[j])) + scale * dot);
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+size_t SymMatrix<T>::run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng) const {
+  Recall<SymMatrix<T>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
+
+  return steps;
+}
+
+template<typename T>
+size_t SymMatrix<T>::run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng) const {
+  Recall<SymMatrix<T>> recall(*this);
+  recall.load(pattern);
+  size_t steps = recall.run(rng);
+  recall.store(out_pattern);
+
+  return steps;
+}
+
+template<typename T>
+size_t SymMatrix<T>::run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<SymMatrix<T>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
+
+template<typename T>
+size_t SymMatrix<T>::run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous, Rng &rng) const {
+  BatchRecall<SymMatrix<T>> recall(*this);
+  return recall.run(patterns, out_patterns, synchronous, rng);
+}
+
+// force declarations of the following templates
+template class SymMatrix<float>;
+template class SymMatrix<double>;
@@ -0,0 +1,222 @@
+#ifndef SYMMETRIC_HPP
+#define SYMMETRIC_HPP
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include "vector.hpp"
+#include "packed.hpp"
+#include "random.hpp"
+#include "instrument.hpp"
+#include "util.hpp"
+
+// tile edge (in neurons) of the packed symmetric layout
+#define SYM_TILE 64
+
+// symmetric zero-diagonal weights that only store the upper triangle as SYM_TILE x SYM_TILE
+// tiles (bi <= bj) in row-major tile order, each tile is contiguous and row-major itself.
+// diagonal tiles keep their (zero) lower half and the last tiles are zero padded so
+// every kernel runs on full tiles, that is N^2 / 2 + N * SYM_TILE / 2 weights instead of N^2.
+// every stored tile serves both W_ij (its rows) and W_ji (its columns)
+template<typename T>
+class SymMatrix {
+public:
+  SymMatrix(size_t N) : num_rows_(N), num_tiles_((N + SYM_TILE - 1) / SYM_TILE), num_patterns_(0),
+    storage_(num_tiles_ * (num_tiles_ + 1) / 2 * SYM_TILE * SYM_TILE) {}
+
+  // same shape arguments as Matrix so it can stand in for hopfield_t
+  SymMatrix(size_t N, size_t M) : SymMatrix(N) {
+    if (N != M) {
+      std::cerr << "Symmetric weights must be square, got " << N << "x" << M << std::endl;
+      std::exit(1);
+    }
+  }
+
+  T operator()(size_t i, size_t j) const {
+    if (i == j) return static_cast<T>(0);
+    if (i > j) std::swap(i, j);
+    return tile(i / SYM_TILE, j / SYM_TILE)[(i % SYM_TILE) * SYM_TILE + (j % SYM_TILE)];
+  }
+
+  void set_all(const T &);
+  void zeroize();
+
+  // local fields h = W x (every tile is read once and applied to both of its halves)
+  template<typename F>
+  void fields(const F *x, F *h) const {
+    std::fill(h, h + num_rows_, static_cast<F>(0));
+    for (size_t bi = 0; bi < num_tiles_; bi++) {
+      for (size_t bj = bi; bj < num_tiles_; bj++) {
+        apply_tile(bi, bj, x, h);
+      }
+    }
+  }
+
+  template<typename F>
+  void fields_batch(const F *x, F *h, const size_t count, const size_t ld) const {
+    for (size_t b = 0; b < count; b++) {
+      std::fill(h + b * ld, h + b * ld + num_rows_, static_cast<F>(0));
+    }
+
+    // a tile stays in cache while every probe uses it
+    for (size_t bi = 0; bi < num_tiles_; bi++) {
+      for (size_t bj = bi; bj < num_tiles_; bj++) {
+        for (size_t b = 0; b < count; b++) {
+          apply_tile(bi, bj, x + b * ld, h + b * ld);
+        }
+      }
+    }
+  }
+
+  // local field of a single neuron sum_j W_ij x_j
+  template<typename F>
+  F field(const size_t i, const F *x) const {
+    const size_t bi = i / SYM_TILE;
+    const size_t r = i % SYM_TILE;
+    F hoist = 0.0;
+
+    // W_ij for j in tiles left of the diagonal is column r of tile (bj, bi)
+    for (size_t bj = 0; bj <= bi; bj++) {
+      const T *t = tile(bj, bi);
+      const size_t j0 = bj * SYM_TILE;
+      const size_t len = std::min(static_cast<size_t>(SYM_TILE), num_rows_ - j0);
+
+      #pragma omp simd reduction(+:hoist)
+      for (size_t c = 0; c < len; c++) {
+        hoist += static_cast<F>(t[c * SYM_TILE + r]) * x[j0 + c];
+      }
+    }
+
+    // and row r of tile (bi, bj) right of it
+    for (size_t bj = bi; bj < num_tiles_; bj++) {
+      const T *t = tile(bi, bj) + r * SYM_TILE;
+      const size_t j0 = bj * SYM_TILE;
+      const size_t len = std::min(static_cast<size_t>(SYM_TILE), num_rows_ - j0);
+
+      #pragma omp simd reduction(+:hoist)
+      for (size_t c = 0; c < len; c++) {
+        hoist += static_cast<F>(t[c]) * x[j0 + c];
+      }
+    }
+    return hoist;
+  }
+
+  // h += scale * W[:, k] (same access pattern as field)
+  template<typename F>
+  void add_column(size_t k, const F &scale, F *h) const {
+    const size_t bk = k / SYM_TILE;
+    const size_t r = k % SYM_TILE;
+
+    for (size_t bj = 0; bj <= bk; bj++) {
+      const T *t = tile(bj, bk);
+      const size_t j0 = bj * SYM_TILE;
+      const size_t len = std::min(static_cast<size_t>(SYM_TILE), num_rows_ - j0);
+
+      #pragma omp simd
+      for (size_t c = 0; c < len; c++) {
+        h[j0 + c] += scale * static_cast<F>(t[c * SYM_TILE + r]);
+      }
+    }
+
+    for (size_t bj = bk; bj < num_tiles_; bj++) {
+      const T *t = tile(bk, bj) + r * SYM_TILE;
+      const size_t j0 = bj * SYM_TILE;
+      const size_t len = std::min(static_cast<size_t>(SYM_TILE), num_rows_ - j0);
+
+      #pragma omp simd
+      for (size_t c = 0; c < len; c++) {
+        h[j0 + c] += scale * static_cast<F>(t[c]);
+      }
+    }
+  }
+
+  // E = -sum_{i<j} w_ij s_i s_j (each stored weight once instead of -1/2 over both halves)
+  template<typename P>
+  double energy(const P &pattern) const {
+    INSTR_COUNT(INSTR_ENERGY_EVALS, 1);
+    std::vector<double> s(num_tiles_ * SYM_TILE, 0.0);
+    for (size_t i = 0; i < num_rows_; i++) {
+      s[i] = static_cast<double>(pattern(i));
+    }
+
+    double e = 0.0;
+    for (size_t bi = 0; bi < num_tiles_; bi++) {
+      for (size_t bj = bi; bj < num_tiles_; bj++) {
+        const T *t = tile(bi, bj);
+        const double *si = &s[bi * SYM_TILE];
+        const double *sj = &s[bj * SYM_TILE];
+        for (size_t r = 0; r < SYM_TILE; r++) {
+          double row = 0.0;
+
+          #pragma omp simd reduction(+:row)
+          for (size_t c = 0; c < SYM_TILE; c++) {
+            row += static_cast<double>(t[r * SYM_TILE + c]) * sj[c];
+          }
+          e -= si[r] * row;
+        }
+      }
+    }
+    return e;
+  }
+
+  void train_on(patterns_t &patterns);
+  void train_on(packed_patterns_t &patterns);
+  void add_pattern(const packed_pattern_t &pattern);
+  void add_patterns(const packed_patterns_t &patterns);
+  void remove_pattern(const packed_pattern_t &pattern);
+  void remove_patterns(const packed_patterns_t &patterns);
+
+  size_t run_to_min(const pattern_t &pattern, pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_to_min(const packed_pattern_t &pattern, packed_pattern_t &out_pattern, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const patterns_t &patterns, patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+  size_t run_batch_to_min(const packed_patterns_t &patterns, packed_patterns_t &out_patterns, const bool synchronous=false, Rng &rng = thread_rng()) const;
+
+  size_t num_rows() const { return num_rows_; }
+  size_t num_cols() const { return num_rows_; }
+  size_t num_patterns() const { return num_patterns_; }
+  size_t num_stored() const { return storage_.size(); }
+
+private:
+  size_t tile_offset(size_t bi, size_t bj) const {
+    return (bi * num_tiles_ - (bi * (bi - 1)) / 2 + (bj - bi)) * SYM_TILE * SYM_TILE;
+  }
+        T *tile(size_t bi, size_t bj)       { return &storage_[tile_offset(bi, bj)]; }
+  const T *tile(size_t bi, size_t bj) const { return &storage_[tile_offset(bi, bj)]; }
+
+  // h_rows += U x_cols and h_cols += U^T x_rows for the stored tile U at (bi, bj)
+  template<typename F>
+  void apply_tile(const size_t bi, const size_t bj, const F *x, F *h) const {
+    const T *t = tile(bi, bj);
+    const size_t i0 = bi * SYM_TILE, j0 = bj * SYM_TILE;
+    const size_t ilen = std::min(static_cast<size_t>(SYM_TILE), num_rows_ - i0);
+    const size_t jlen = std::min(static_cast<size_t>(SYM_TILE), num_rows_ - j0);
+    const F *xj = x + j0;
+    F *hj = h + j0;
+
+    for (size_t r = 0; r < ilen; r++) {
+      const T *row = t + r * SYM_TILE;
+      const F xr = x[i0 + r];
+      F hoist = 0.0;
+
+      #pragma omp simd reduction(+:hoist)
+      for (size_t c = 0; c < jlen; c++) {
+        const F w = static_cast<F>(row[c]);
+        hoist += w * xj[c];
+        hj[c] += w * xr;
+      }
+      h[i0 + r] += hoist;
+    }
+  }
+
+  void hebbian(const packed_patterns_t &patterns, const double keep, const double scale);
+
+  size_t         num_rows_, num_tiles_;
+  size_t         num_patterns_;
+  std::vector<T> storage_;
+};
+
+typedef SymMatrix<double> sym_hopfield_t;
+
+#endif
@@ -4,6 +4,7 @@
 #include <random>
 #include <vector>
 #include <cmath>
+#include "random.hpp"
 
 #define EPS 0.0001 // define arbitrary epsilon to compare doubles
 
@@ -25,28 +26,31 @@ bool inline dcompare(const double &f, const double &s) {
   return std::abs(f - s) <= EPS;
 }
 
-// random function based off of https://stackoverflow.com/questions/288739/generate-random-numbers-uniformly-over-an-entire-range
+// uniform random values drawn from the given stream
 template <typename T>
-T random_uniform(const T &range_from, const T &range_to) {
-  std::random_device rand_dev;
-  std::mt19937 generator(rand_dev());
-  std::uniform_real_distribution<T> distr(range_from, range_to);
-  return distr(generator);
+T random_uniform(Rng &rng, const T &range_from, const T &range_to) {
+  return static_cast<T>(rng.uniform(static_cast<double>(range_from), static_cast<double>(range_to)));
 }
 
 template <typename T>
-std::vector<T> random_uniform_vector(const size_t num, const double &range_from, const double &range_to) {
-  std::random_device rand_dev;
-  std::mt19937 generator(rand_dev());
-  std::uniform_real_distribution<double> distr(range_from, range_to);
+T random_uniform(const T &range_from, const T &range_to) {
+  return random_uniform<T>(thread_rng(), range_from, range_to);
+}
 
+template <typename T>
+std::vector<T> random_uniform_vector(Rng &rng, const size_t num, const double &range_from, const double &range_to) {
   std::vector<T> vals(num);
   for (size_t i = 0; i < vals.size(); i++) {
-    vals[i] = static_cast<T>(distr(generator));
+    vals[i] = static_cast<T>(rng.uniform(range_from, range_to));
   }
   return vals;
 }
 
+template <typename T>
+std::vector<T> random_uniform_vector(const size_t num, const double &range_from, const double &range_to) {
+  return random_uniform_vector<T>(thread_rng(), num, range_from, range_to);
+}
+
 // std::vector<size_t> random_index_vector(size_t num) {
 //   // create vector of indices (from original pattern)
 //   std::vector<size_t> indx(orig.num_rows());
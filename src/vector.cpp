@@ -1,5 +1,6 @@
 #include "vector.hpp"
 #include "util.hpp"
+#include "arena.hpp"
 #include <type_traits>
 
 template <typename T>
@@ -15,25 +16,21 @@ void Vector<T>::zeroize() {
 }
 
 template <typename T>
-void Vector<T>::randomize(const T &range_from, const T &range_to) {
-  storage_ = random_uniform_vector<T>(storage_.size(), range_from, range_to);
+void Vector<T>::randomize(const T &range_from, const T &range_to, Rng &rng) {
+  storage_ = random_uniform_vector<T>(rng, storage_.size(), range_from, range_to);
 }
 
 template<typename T>
-void Vector<T>::randomize() {
-    std::random_device rand_dev;
-    std::mt19937 generator(rand_dev());
-    std::uniform_int_distribution<short> distr(0, 1); 
+void Vector<T>::randomize(Rng &rng) {
+    // draw 64 neurons per random word (the same bits a PackedPattern draws from the stream)
+    Scratch<uint64_t, SCRATCH_WORDS> bits_lease;
+    std::vector<uint64_t> &bits = *bits_lease;
+    bits.resize((num_rows() + 63) / 64);
+    rng.fill(bits.data(), bits.size());
 
     // uniform [0, 1] for pattern
-    if (std::is_same<T, int>::value || std::is_same<T, short>::value) {
-      for (size_t i = 0; i < num_rows(); i++) {
-        storage_[i] = (distr(generator) * 2) - 1; // map to -1 or 1
-      }
-    } else {
-      for (size_t i = 0; i < num_rows(); i++) {
-        storage_[i] = static_cast<T>((distr(generator) * 2.0) - 1.0); // map to -1 or 1
-      }
+    for (size_t i = 0; i < num_rows(); i++) {
+      storage_[i] = static_cast<T>(((bits[i / 64] >> (i % 64)) & 1) ? 1 : -1); // map to -1 or 1
     }
 }
 
@@ -54,27 +51,55 @@ size_t Vector<T>::hamming(Vector<T> &other) {
 }
 
 
-void make_random_patterns(const size_t neurons, patterns_t &patts, const size_t num) {
+void make_random_patterns(const size_t neurons, patterns_t &patts, const size_t num, Rng &rng) {
     // create random patterns
     for (size_t i = 0; i < num; i++) {
       pattern_t npattern(neurons);
-      npattern.randomize();
-      patts.push_back(npattern);
+      npattern.randomize(rng);
+      patts.push_back(std::move(npattern));
+    }
+}
+
+void fill_random_patterns(const size_t neurons, patterns_t &patts, const size_t first, const size_t num, Rng &rng) {
+    size_patterns(patts, first + num, neurons);
+    for (size_t i = first; i < first + num; i++) {
+      patts[i].randomize(rng);
     }
 }
 
-void make_hammed_patterns(const pattern_t &orig, patterns_t &patts, const size_t num, const short distance, bool incremental) {
+void fill_hammed_patterns(const pattern_t &orig, patterns_t &patts, const size_t first, const size_t num, const size_t distance, Rng &rng) {
+    Scratch<size_t, SCRATCH_HAMMED> indx_lease;
+    std::vector<size_t> &indx = *indx_lease;
+    indx.resize(orig.num_rows());
+    for (size_t i = 0; i < indx.size(); i++) {
+      indx[i] = i;
+    }
+
+    rng.partial_shuffle(indx.begin(), indx.end(), num * distance);
+
+    // copy assignment keeps the storage of the pattern being overwritten
+    size_patterns(patts, first + num, orig.num_rows());
+    for (size_t i = 0; i < num; i++) {
+      pattern_t &patt = patts[first + i];
+      patt = orig;
+      for (size_t j = (i*distance); j < ((i + 1)*distance); j++) {
+        size_t id = indx[j % orig.num_rows()];
+        patt(id) = -1*patt(id);
+      }
+    }
+}
+
+void make_hammed_patterns(const pattern_t &orig, patterns_t &patts, const size_t num, const size_t distance, bool incremental, Rng &rng) {
     // create vector of indices (from original pattern)
-    std::vector<size_t> indx(orig.num_rows());
+    Scratch<size_t, SCRATCH_HAMMED> indx_lease;
+    std::vector<size_t> &indx = *indx_lease;
+    indx.resize(orig.num_rows());
     for (size_t i = 0; i < indx.size(); i++) {
       indx[i] = i;
     }
     
-    // randomly shuffle indices
-    std::random_device rand_dev;
-    std::mt19937 generator(rand_dev());
-    std::shuffle(indx.begin(), indx.end(), generator);
-    size_t dist = static_cast<size_t>(distance);
+    // randomly shuffle indices (only the ones that will be flipped need drawing)
+    rng.partial_shuffle(indx.begin(), indx.end(), num * distance);
 
     // for each new pattern randomly change by the distance
     for (size_t i = 0; i < num; i++) {
@@ -82,13 +107,29 @@ void make_hammed_patterns(const pattern_t &orig, patterns_t &patts, const size_t
       pattern_t patt = (incremental) ? (patts.at(i).copy()) : orig.copy();
 
       // shift through indices
-      for (size_t j = (i*dist); j < ((i + 1)*dist); j++) {
+      for (size_t j = (i*distance); j < ((i + 1)*distance); j++) {
         size_t id = indx[j % orig.num_rows()]; // get random indx
         patt(id) = -1*patt(id);  // flip a random index
       }
 
       // add the new pattern
-      patts.push_back(patt);
+      patts.push_back(std::move(patt));
+    }
+}
+
+void make_hammed_flips(const size_t neurons, std::vector<size_t> &flips, const size_t num, const size_t distance, Rng &rng) {
+    Scratch<size_t, SCRATCH_HAMMED> indx_lease;
+    std::vector<size_t> &indx = *indx_lease;
+    indx.resize(neurons);
+    for (size_t i = 0; i < indx.size(); i++) {
+      indx[i] = i;
+    }
+
+    rng.partial_shuffle(indx.begin(), indx.end(), num * distance);
+
+    flips.resize(num * distance);
+    for (size_t j = 0; j < flips.size(); j++) {
+      flips[j] = indx[j % neurons];
     }
 }
 
@@ -6,6 +6,7 @@
 #include <type_traits>
 #include <iostream>
 #include <algorithm>
+#include <utility>
 #include "util.hpp"
 
 template <typename T>
@@ -13,14 +14,15 @@ class Vector {
 public:
   Vector(size_t M) : num_rows_(M), storage_(num_rows_) {}
   Vector(size_t M, const std::vector<T> &C) : num_rows_(M), storage_(C) {}
+  Vector(size_t M, std::vector<T> &&C) : num_rows_(M), storage_(std::move(C)) {}
 
         T& operator()(size_t i)       { return storage_[i]; }
   const T& operator()(size_t i) const { return storage_[i]; }
 
   void set_all(const T &);
   void zeroize();
-  void randomize(const T &, const T &);
-  void randomize();
+  void randomize(const T &, const T &, Rng &rng = thread_rng());
+  void randomize(Rng &rng = thread_rng());
   Vector<T> hammed_random(const T &, const T &, const size_t); 
 
   template<typename C=short>
@@ -61,7 +63,7 @@ public:
     for(size_t i = 0; i < ndata.size(); i++) {
       ndata.at(i) = static_cast<C>(storage_.at(i));
     }
-    return Vector<C>(num_rows(), ndata);
+    return Vector<C>(num_rows(), std::move(ndata));
   }
 
   void print() {
@@ -85,8 +87,16 @@ typedef Vector<short> pattern_t;
 typedef std::vector<Vector<short>> patterns_t;
 typedef std::vector<Vector<short>>* patterns_pt;
 
-void make_random_patterns(const size_t neurons, patterns_t &patts, const size_t num);
-void make_hammed_patterns(const pattern_t &orig, patterns_t &patts, const size_t num, const short distance, bool incremental);
+void make_random_patterns(const size_t neurons, patterns_t &patts, const size_t num, Rng &rng = thread_rng());
+void make_hammed_patterns(const pattern_t &orig, patterns_t &patts, const size_t num, const size_t distance, bool incremental, Rng &rng = thread_rng());
+
+// in place versions reusing the patterns patts already holds (see packed.hpp)
+void fill_random_patterns(const size_t neurons, patterns_t &patts, const size_t first, const size_t num, Rng &rng = thread_rng());
+void fill_hammed_patterns(const pattern_t &orig, patterns_t &patts, const size_t first, const size_t num, const size_t distance, Rng &rng = thread_rng());
+
+// the neurons fill_hammed_patterns would flip (same draws) without writing the probes,
+// probe i flips flips[i * distance, (i + 1) * distance) of the original
+void make_hammed_flips(const size_t neurons, std::vector<size_t> &flips, const size_t num, const size_t distance, Rng &rng = thread_rng());
 void delete_patterns(patterns_pt patts);
 
 #endif
\ No newline at end of file